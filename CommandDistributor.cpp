@@ -35,6 +35,10 @@
 // variables to hold clock time
 int16_t lastclocktime;
 int8_t lastclockrate;
+// Internal fast clock, for stations without an EX-FastClock
+bool fastClockRunning=false;
+unsigned long fastClockLastMillis;
+unsigned long fastClockElapsed; // fast ms into current minute
 
 
 #if WIFI_ON || ETHERNET_ON || defined(SERIAL1_COMMANDS) || defined(SERIAL2_COMMANDS) || defined(SERIAL3_COMMANDS)
@@ -49,7 +53,7 @@ template<typename... Targs> void CommandDistributor::broadcastReply(clientType t
 // on a single USB connection config, write direct to Serial and ignore flush/shove
 template<typename... Targs> void CommandDistributor::broadcastReply(clientType type, Targs... msg){
   (void)type; //shut up compiler warning
-  StringFormatter::send(&USB_SERIAL, msg...);
+  StringFormatter::send(SerialManager::output(&USB_SERIAL), msg...);
 }
 #endif 
 
@@ -161,6 +165,14 @@ void  CommandDistributor::broadcastTurnout(int16_t id, bool isClosed ) {
 #endif
 }
 
+// Reports a write on main as sent, in the form of the command that asked for it
+void CommandDistributor::broadcastPOM(int16_t cab, int16_t cv, byte bit, byte value) {
+  if (bit == POM_BYTE)
+    broadcastReply(COMMAND_TYPE, F("<w %d %d %d>\n"), cab, cv, value);
+  else
+    broadcastReply(COMMAND_TYPE, F("<b %d %d %d %d>\n"), cab, cv, bit & 0x07, (bit >> 3) & 1);
+}
+
 void  CommandDistributor::broadcastClockTime(int16_t time, int8_t rate) {
   // The JMRI clock command is of the form : PFT65871<;>4
   // The CS broadcast is of the form "<jC mmmm nn" where mmmm is time minutes and dd speed
@@ -182,13 +194,14 @@ void CommandDistributor::setClockTime(int16_t clocktime, int8_t clockrate, byte
       if (clocktime != lastclocktime){
         // CAH. DIAG removed because LCD does it anyway. 
         LCD(6,F("Clk Time:%d Sp %d"), clocktime, clockrate);
+        if (Diag::RECORD) DIAG(F("REC %l K %d %d"), millis(), clocktime, clockrate);
         // look for an event for this time
         RMFT2::clockEvent(clocktime,1);
         // Now tell everyone else what the time is.
         CommandDistributor::broadcastClockTime(clocktime, clockrate);
         lastclocktime = clocktime;
-        lastclockrate = clockrate;
       }
+      lastclockrate = clockrate;
       return;
 
     case 2:
@@ -202,6 +215,27 @@ int16_t CommandDistributor::retClockTime() {
   return lastclocktime;
 }
 
+// Start or stop the internal fast clock.  It runs from the last time set,
+// at the last rate set (times real time), so <JC mmmm nn> followed by
+// <JC START> runs the clock without an EX-FastClock or JMRI.
+void CommandDistributor::startFastClock(bool run) {
+  fastClockRunning=run;
+  fastClockLastMillis=millis();
+  fastClockElapsed=0;
+}
+
+// Advance the internal fast clock a minute at a time, giving the same
+// ONTIME events and broadcasts as an external clock.
+void CommandDistributor::fastClockLoop() {
+  if (!fastClockRunning || lastclockrate<=0) return;
+  unsigned long now=millis();
+  fastClockElapsed+=(now-fastClockLastMillis)*lastclockrate;
+  fastClockLastMillis=now;
+  if (fastClockElapsed < 60000UL) return;
+  fastClockElapsed-=60000UL;
+  setClockTime((lastclocktime+1) % 1440, lastclockrate, 1);
+}
+
 void  CommandDistributor::broadcastLoco(byte slot) {
   DCC::LOCO * sp=&DCC::speedTable[slot];
   broadcastReply(COMMAND_TYPE, F("<l %d %d %d %l>\n"), sp->loco,slot,sp->speedCode,sp->functions);
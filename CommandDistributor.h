@@ -50,8 +50,11 @@ public :
   static void broadcastSensor(int16_t id, bool value);
   static void broadcastTurnout(int16_t id, bool isClosed);
   static void broadcastClockTime(int16_t time, int8_t rate);
+  static void broadcastPOM(int16_t cab, int16_t cv, byte bit, byte value);
   static void setClockTime(int16_t time, int8_t rate, byte opt);
   static int16_t retClockTime();
+  static void fastClockLoop();
+  static void startFastClock(bool run);
   static void broadcastPower();
   static void broadcastRaw(clientType type,char * msg);
   static void broadcastTrackState(const FSH* format,byte trackLetter,int16_t dcAddr);
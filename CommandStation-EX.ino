@@ -130,6 +130,48 @@ void setup()
   CommandDistributor::broadcastPower();
 }
 
+#if defined(DIAG_LOOPTIMES)
+// Time taken by each responsibility in loop(), so that on a heavily loaded
+// layout it is clear which part is using the time.  Averages and maxima
+// are reported every 5 seconds with the free memory low watermark.
+enum { LT_DCC, LT_SERIAL, LT_NET, LT_EXRAIL, LT_DISPLAY, LT_IO, LT_SENSORS, LT_COUNT };
+static unsigned long loopTotal[LT_COUNT];
+static unsigned long loopMax[LT_COUNT];
+static unsigned long loopMark = 0;
+static unsigned long loopCount = 0;
+
+static void loopTime(byte section) {
+  unsigned long now = micros();
+  unsigned long elapsed = now - loopMark;
+  loopTotal[section] += elapsed;
+  if (elapsed > loopMax[section]) loopMax[section] = elapsed;
+  loopMark = now;
+}
+
+static void loopTimeReport() {
+  static unsigned long lastReport = 0;
+  loopCount++;
+  if (millis() - lastReport >= 5000) {
+    if (lastReport > 0) {
+      unsigned long a[LT_COUNT];
+      for (byte i = 0; i < LT_COUNT; i++) a[i] = loopTotal[i] / loopCount;
+      DIAG(F("Loops:%l DCC:%lus(%l) Serial:%lus(%l) Net:%lus(%l) EXRAIL:%lus(%l) Display:%lus(%l) IO:%lus(%l) Sensors:%lus(%l) Free:%db"),
+        loopCount, a[LT_DCC], loopMax[LT_DCC], a[LT_SERIAL], loopMax[LT_SERIAL],
+        a[LT_NET], loopMax[LT_NET], a[LT_EXRAIL], loopMax[LT_EXRAIL],
+        a[LT_DISPLAY], loopMax[LT_DISPLAY], a[LT_IO], loopMax[LT_IO],
+        a[LT_SENSORS], loopMax[LT_SENSORS], DCCTimer::getMinimumFreeMemory());
+    }
+    for (byte i = 0; i < LT_COUNT; i++) loopTotal[i] = loopMax[i] = 0;
+    loopCount = 0;
+    lastReport = millis();
+  }
+  loopMark = micros();  // Don't charge the report to the next loop
+}
+#define LOOPTIME(section) loopTime(section)
+#else
+#define LOOPTIME(section)
+#endif
+
 void loop()
 {
   // The main sketch has responsibilities during loop()
@@ -137,9 +179,11 @@ void loop()
   // Responsibility 1: Handle DCC background processes
   //                   (loco reminders and power checks)
   DCC::loop();
+  LOOPTIME(LT_DCC);
 
   // Responsibility 2: handle any incoming commands on USB connection
   SerialManager::loop();
+  LOOPTIME(LT_SERIAL);
 
   // Responsibility 3: Optionally handle any incoming WiFi traffic
 #ifndef ARDUINO_ARCH_ESP32
@@ -154,8 +198,11 @@ void loop()
 #if ETHERNET_ON
   EthernetInterface::loop();
 #endif
+  LOOPTIME(LT_NET);
 
   RMFT::loop();  // ignored if no automation
+  CommandDistributor::fastClockLoop();  // ignored unless internal fast clock started
+  LOOPTIME(LT_EXRAIL);
 
   #if defined(LCN_SERIAL)
   LCN::loop();
@@ -163,11 +210,14 @@ void loop()
 
   // Display refresh
   DisplayInterface::loop();
+  LOOPTIME(LT_DISPLAY);
 
   // Handle/update IO devices.
   IODevice::loop();
+  LOOPTIME(LT_IO);
 
   Sensor::checkAll(); // Update and print changes
+  LOOPTIME(LT_SENSORS);
 
   // Report any decrease in memory (will automatically trigger on first call)
   static int ramLowWatermark = __INT_MAX__; // replaced on first loop
@@ -177,4 +227,7 @@ void loop()
     ramLowWatermark = freeNow;
     LCD(3,F("Free RAM=%5db"), ramLowWatermark);
   }
+#if defined(DIAG_LOOPTIMES)
+  loopTimeReport();
+#endif
 }
@@ -29,6 +29,7 @@
 #ifndef DISABLE_EEPROM
 #include "EEStore.h"
 #endif
+#include "LocoStore.h"
 #include "GITHUB_SHA.h"
 #include "version.h"
 #include "FSH.h"
@@ -37,6 +38,7 @@
 #include "CommandDistributor.h"
 #include "TrackManager.h"
 #include "DCCTimer.h"
+#include "SerialManager.h"
 
 // This module is responsible for converting API calls into
 // messages to be sent to the waveform generator.
@@ -56,17 +58,51 @@ const byte FN_GROUP_2=0x02;
 const byte FN_GROUP_3=0x04;
 const byte FN_GROUP_4=0x08;
 const byte FN_GROUP_5=0x10;
+// groupFlags bits for the loco's speed step mode (zero means use global setting)
+const byte SPEEDSTEPS_MASK=0x60;
+const byte SPEEDSTEPS_28=0x20;
+const byte SPEEDSTEPS_128=0x40;
+const byte SPEEDSTEPS_14=0x60;
+// groupFlags bit for a loco whose speed is sent to its consist address
+const byte CONSIST_MEMBER=0x80;
+
+// Speed byte (0-127, 0=stop, 1=emergency stop) to 28 step speed code, 
+// bits 0-3 being the speed and bit 4 the intermediate step.
+static const byte FLASH speedCode28[128] = {
+  0x00, 0x01, 0x02, 0x02, 0x02, 0x02, 0x12, 0x12, 0x12, 0x12, 0x12, 0x03, 0x03, 0x03, 0x03, 0x13,
+  0x13, 0x13, 0x13, 0x13, 0x04, 0x04, 0x04, 0x04, 0x14, 0x14, 0x14, 0x14, 0x14, 0x05, 0x05, 0x05,
+  0x05, 0x05, 0x15, 0x15, 0x15, 0x15, 0x06, 0x06, 0x06, 0x06, 0x06, 0x16, 0x16, 0x16, 0x16, 0x07,
+  0x07, 0x07, 0x07, 0x07, 0x17, 0x17, 0x17, 0x17, 0x17, 0x08, 0x08, 0x08, 0x08, 0x18, 0x18, 0x18,
+  0x18, 0x18, 0x09, 0x09, 0x09, 0x09, 0x19, 0x19, 0x19, 0x19, 0x19, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a,
+  0x1a, 0x1a, 0x1a, 0x1a, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x1b, 0x1b, 0x1b, 0x1b, 0x0c, 0x0c, 0x0c,
+  0x0c, 0x0c, 0x1c, 0x1c, 0x1c, 0x1c, 0x1c, 0x0d, 0x0d, 0x0d, 0x0d, 0x1d, 0x1d, 0x1d, 0x1d, 0x1d,
+  0x0e, 0x0e, 0x0e, 0x0e, 0x1e, 0x1e, 0x1e, 0x1e, 0x1e, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x1f, 0x1f,
+};
+// Speed byte (0-127) to 14 step speed code (bits 0-3).
+static const byte FLASH speedCode14[128] = {
+  0x00, 0x01, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x03, 0x03, 0x03, 0x03, 0x03,
+  0x03, 0x03, 0x03, 0x03, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x05, 0x05, 0x05,
+  0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x06, 0x07,
+  0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x07, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08,
+  0x08, 0x08, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x0a, 0x0a, 0x0a, 0x0a, 0x0a,
+  0x0a, 0x0a, 0x0a, 0x0a, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0c, 0x0c, 0x0c,
+  0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0d, 0x0d, 0x0d, 0x0d, 0x0d, 0x0d, 0x0d, 0x0d, 0x0d,
+  0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0e, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f, 0x0f,
+};
 
 FSH* DCC::shieldName=NULL;
 byte DCC::globalSpeedsteps=128;
 
 void DCC::begin() {
-  StringFormatter::send(&USB_SERIAL,F("<iDCC-EX V-%S / %S / %S G-%S>\n"), F(VERSION), F(ARDUINO_TYPE), shieldName, F(GITHUB_SHA));
+  StringFormatter::send(SerialManager::output(&USB_SERIAL),F("<iDCC-EX V-%S / %S / %S G-%S>\n"), F(VERSION), F(ARDUINO_TYPE), shieldName, F(GITHUB_SHA));
 #ifndef DISABLE_EEPROM
   // Load stuff from EEprom
   (void)EEPROM; // tell compiler not to warn this is unused
   EEStore::init();
 #endif
+#ifdef LOCO_STORE_ACTIVE
+  LocoStore::init();  // reinstate locos from before the restart
+#endif
 #ifndef ARDUINO_ARCH_ESP32 /* On ESP32 started in TrackManager::setTrackMode() */
   DCCWaveform::begin();
 #endif
@@ -74,14 +110,25 @@ void DCC::begin() {
 
 
 void DCC::setThrottle( uint16_t cab, uint8_t tSpeed, bool tDirection)  {
+  // A consist member is driven through its consist address, the decoder
+  // applies its own direction from CV19.
+  bool reversed;
+  int consist=lookupConsistMember(cab, reversed);
+  if (consist>=0) {
+    cab=consists[consist].address;
+    if (reversed) tDirection=!tDirection;
+  }
+  else if (cab>0 && cab<=HIGHEST_SHORT_ADDR) consist=lookupConsist(cab);
+
   byte speedCode = (tSpeed & 0x7F)  + tDirection * 128;
-  setThrottle2(cab, speedCode);
+  setThrottle2(cab, speedCode, getSpeedSteps(cab));
   TrackManager::setDCSignal(cab,speedCode); // in case this is a dcc track on this addr
   // retain speed for loco reminders
   updateLocoReminder(cab, speedCode );
+  if (consist>=0) updateConsistMembers(consist, speedCode);
 }
 
-void DCC::setThrottle2( uint16_t cab, byte speedCode)  {
+void DCC::setThrottle2( uint16_t cab, byte speedCode, byte speedSteps)  {
 
   uint8_t b[4];
   uint8_t nB = 0;
@@ -91,26 +138,18 @@ void DCC::setThrottle2( uint16_t cab, byte speedCode)  {
     b[nB++] = highByte(cab) | 0xC0;    // convert train number into a two-byte address
   b[nB++] = lowByte(cab);
 
-  if (globalSpeedsteps <= 28) {
-
-    uint8_t speed128 = speedCode & 0x7F;
-    uint8_t speed28;
-    uint8_t code28;
+  if (speedSteps == 0) speedSteps = globalSpeedsteps;
+  if (speedSteps == 14) {
+    // In 14 step mode, bit 4 of the speed code carries F0.
+    byte code14 = GETFLASH(&speedCode14[speedCode & 0x7F]);
+    int reg = (cab != 0) ? lookupSpeedTable(cab, false) : -1;
+    if (reg >= 0 && (speedTable[reg].functions & 1)) code14 |= 0b00010000;
+    b[nB++] = 0b01000000 | code14 | ((speedCode & 0x80) ? 0b00100000 : 0);
 
-    if (speed128 == 0 || speed128 == 1) { // stop or emergency stop
-      code28 = speed128;
-    } else {
-      speed28= (speed128*10+36)/46;                 // convert 2-127 to 1-28
-/*
-      if (globalSpeedsteps <= 14)                   // Don't want to do 14 steps, to get F0 there is ugly
-        code28 = (speed28+3)/2 | (Value of F0);     // convert 1-28 to DCC 14 step speed code
-      else
-*/
-      code28 = (speed28+3)/2 | ( (speed28 & 1) ? 0 : 0b00010000 ); // convert 1-28 to DCC 28 step speed code
-    }
+  } else if (speedSteps <= 28) {
     //        Construct command byte from:
     //        command      speed    direction
-    b[nB++] = 0b01000000 | code28 | ((speedCode & 0x80) ? 0b00100000 : 0);
+    b[nB++] = 0b01000000 | GETFLASH(&speedCode28[speedCode & 0x7F]) | ((speedCode & 0x80) ? 0b00100000 : 0);
 
   } else { // 128 speedsteps
 
@@ -122,6 +161,40 @@ void DCC::setThrottle2( uint16_t cab, byte speedCode)  {
   DCCWaveform::mainTrack.schedulePacket(b, nB, 0);
 }
 
+// Speed step mode for the loco in a speed table slot (14, 28 or 128).
+byte DCC::speedStepsOf(int reg) {
+  switch (speedTable[reg].groupFlags & SPEEDSTEPS_MASK) {
+    case SPEEDSTEPS_14: return 14;
+    case SPEEDSTEPS_28: return 28;
+    case SPEEDSTEPS_128: return 128;
+    default: return globalSpeedsteps;
+  }
+}
+
+byte DCC::getSpeedSteps(int cab) {
+  int reg=lookupSpeedTable(cab, false);
+  return (reg<0) ? globalSpeedsteps : speedStepsOf(reg);
+}
+
+// Set speed step mode for one loco: 14, 28 or 128, or 0 to follow the 
+// global setting.  The loco's speed is resent in the new mode.
+bool DCC::setSpeedSteps(int cab, byte speedSteps) {
+  byte flag;
+  switch (speedSteps) {
+    case 0: flag = 0; break;
+    case 14: flag = SPEEDSTEPS_14; break;
+    case 28: flag = SPEEDSTEPS_28; break;
+    case 128: flag = SPEEDSTEPS_128; break;
+    default: return false;
+  }
+  if (cab <= 0) return false;
+  int reg=lookupSpeedTable(cab);
+  if (reg<0) return false;
+  speedTable[reg].groupFlags = (speedTable[reg].groupFlags & ~SPEEDSTEPS_MASK) | flag;
+  setThrottle2(cab, speedTable[reg].speedCode, speedStepsOf(reg));
+  return true;
+}
+
 void DCC::setFunctionInternal(int cab, byte byte1, byte byte2) {
   // DIAG(F("setFunctionInternal %d %x %x"),cab,byte1,byte2);
   byte b[4];
@@ -266,55 +339,168 @@ void DCC::setAccessory(int address, byte port, bool gate, byte onoff /*= 2*/) {
   // second byte is of the form 1AAACPPG, where C is 1 for on, PP the ports 0 to 3 and G the gate (coil).
   b[0] = address % 64 + 128;
   b[1] = ((((address / 64) % 8) << 4) + (port % 4 << 1) + gate % 2) ^ 0xF8;
+  // Queue both packets or neither, so an "on" is never left without its "off"
+  byte packets = (onoff > 1) ? 2 : 1;
+  if (accessoryQueueCount + packets > ACCESSORY_QUEUE_SIZE) {
+    DIAG(F("Accessory queue full, %d/%d not sent"), address, port);
+    return;
+  }
+  uint16_t pulseMs = 0;
   if (onoff != 0) {
-    DCCWaveform::mainTrack.schedulePacket(b, 2, 3);      // Repeat on packet three times
+    queueAccessoryPacket(b, 2, false, 0);
 #if defined(EXRAIL_ACTIVE)
     RMFT2::activateEvent(address<<2|port,gate);
 #endif
+    // Find pulse time for this accessory if it's been set up, else use default.
+    pulseMs = ACCESSORY_PULSE_MS;
+    for (byte i=0; i<accessoryPulseCount; i++) {
+      if (accessoryPulses[i].packedAddress == (address<<2|port)) {
+        pulseMs = accessoryPulses[i].pulseMs;
+        break;
+      }
+    }
   }
   if (onoff != 1) {
     b[1] &= ~0x08; // set C to 0
-    DCCWaveform::mainTrack.schedulePacket(b, 2, 3);      // Repeat off packet three times
+    // With an "on" packet before it, the pulse is timed from when that is sent
+    queueAccessoryPacket(b, 2, onoff != 0, pulseMs);
   }
 }
 
 //
-// writeCVByteMain: Write a byte with PoM on main. This writes
-// the 5 byte sized packet to implement this DCC function
+// setExtendedAccessory: send an extended accessory packet, e.g. a signal aspect.
+// Format is 10AAAAAA 0AAA0AA1 XXXXXXXX where the 11 bit address has the top 
+// three bits inverted in the second byte.
 //
-void DCC::writeCVByteMain(int cab, int cv, byte bValue)  {
-  byte b[5];
+bool DCC::setExtendedAccessory(int16_t address, byte aspect) {
+  if (address != (address & 0x7FF)) return false;
+  byte b[3];
+  b[0] = 0x80 | ((address >> 2) & 0x3F);
+  b[1] = 0x01 | (((~address >> 8) & 0x07) << 4) | ((address & 0x03) << 1);
+  b[2] = aspect;
+  if (accessoryQueueCount >= ACCESSORY_QUEUE_SIZE) return false;
+  queueAccessoryPacket(b, 3, false, 0);
+  return true;
+}
+
+//
+// setAccessoryPulse: set time between "on" and "off" packets for one accessory
+// output, overriding ACCESSORY_PULSE_MS.
+//
+bool DCC::setAccessoryPulse(int address, byte port, uint16_t pulseMs) {
+  if (address != (address & 511) || port != (port & 3)) return false;
+  if (pulseMs > 30000) return false;  // must fit in 16 bit millis() arithmetic
+  uint16_t packedAddress = address<<2 | port;
+  byte i;
+  for (i=0; i<accessoryPulseCount; i++) 
+    if (accessoryPulses[i].packedAddress == packedAddress) break;
+  if (i == accessoryPulseCount) {
+    if (accessoryPulseCount >= MAX_ACCESSORY_PULSES) return false;
+    accessoryPulseCount++;
+  }
+  accessoryPulses[i].packedAddress = packedAddress;
+  accessoryPulses[i].pulseMs = pulseMs;
+  return true;
+}
+
+// Add packet to the accessory queue.  It is sent delayMs after now, or with
+// afterPrevious set, delayMs after the packet queued before it is sent.
+// Callers check there is room first.
+void DCC::queueAccessoryPacket(byte *packet, byte length, bool afterPrevious, uint16_t delayMs) {
+  ACCESSORY_PACKET *ap = &accessoryQueue[accessoryQueueCount++];
+  for (byte i=0; i<length; i++) ap->packet[i] = packet[i];
+  ap->length = length;
+  ap->waiting = afterPrevious;
+  ap->due = afterPrevious ? delayMs : (uint16_t)millis() + delayMs;
+}
+
+// Send the first queued accessory packet that is due.  Returns false if
+// nothing was sent.
+bool DCC::issueAccessoryPacket() {
+  uint16_t now = millis();
+  for (byte i=0; i<accessoryQueueCount; i++) {
+    if (!accessoryQueue[i].waiting && (int16_t)(now - accessoryQueue[i].due) >= 0) {
+      DCCWaveform::mainTrack.schedulePacket(accessoryQueue[i].packet, 
+        accessoryQueue[i].length, 3);    // Repeat packet three times
+      // Start the pulse time of a packet waiting for this one
+      if (i+1 < accessoryQueueCount && accessoryQueue[i+1].waiting) {
+        accessoryQueue[i+1].waiting = false;
+        accessoryQueue[i+1].due += now;
+      }
+      // Close the gap in the queue
+      accessoryQueueCount--;
+      for (byte j=i; j<accessoryQueueCount; j++)
+        accessoryQueue[j] = accessoryQueue[j+1];
+      return true;
+    }
+  }
+  return false;
+}
+
+//
+// pomPacket: Build the packet for a write on main.  Returns the length.
+//
+byte DCC::pomPacket(byte *b, int cab, int cv, byte opcode, byte value) {
   byte nB = 0;
   if (cab > HIGHEST_SHORT_ADDR)
     b[nB++] = highByte(cab) | 0xC0;    // convert train number into a two-byte address
 
   b[nB++] = lowByte(cab);
-  b[nB++] = cv1(WRITE_BYTE_MAIN, cv); // any CV>1023 will become modulus(1024) due to bit-mask of 0x03
+  b[nB++] = cv1(opcode, cv); // any CV>1023 will become modulus(1024) due to bit-mask of 0x03
   b[nB++] = cv2(cv);
-  b[nB++] = bValue;
+  b[nB++] = value;
+  return nB;
+}
 
-  DCCWaveform::mainTrack.schedulePacket(b, nB, 4);
+//
+// writeCVByteMain: Write a byte with PoM on main.  The write is queued 
+// and sent from loop() in order.  Returns false, and sends nothing, if the 
+// queue is full; callers check getPOMQueueSpace() first or wait for room.
+//
+bool DCC::writeCVByteMain(int cab, int cv, byte bValue)  {
+  return queuePOM(cab, cv, bValue, POM_BYTE);
 }
 
 //
-// writeCVBitMain: Write a bit of a byte with PoM on main. This writes
-// the 5 byte sized packet to implement this DCC function
+// writeCVBitMain: Write a bit of a byte with PoM on main, queued as above.
 //
-void DCC::writeCVBitMain(int cab, int cv, byte bNum, bool bValue)  {
-  byte b[5];
-  byte nB = 0;
+bool DCC::writeCVBitMain(int cab, int cv, byte bNum, bool bValue)  {
   bValue = bValue % 2;
   bNum = bNum % 8;
+  return queuePOM(cab, cv, 0, bNum | (bValue << 3));
+}
 
-  if (cab > HIGHEST_SHORT_ADDR)
-    b[nB++] = highByte(cab) | 0xC0;    // convert train number into a two-byte address
-
-  b[nB++] = lowByte(cab);
-  b[nB++] = cv1(WRITE_BIT_MAIN, cv); // any CV>1023 will become modulus(1024) due to bit-mask of 0x03
-  b[nB++] = cv2(cv);
-  b[nB++] = WRITE_BIT | (bValue ? BIT_ON : BIT_OFF) | bNum;
+bool DCC::queuePOM(int cab, int cv, byte value, byte bit) {
+  if (pomQueueCount >= POM_QUEUE_SIZE) return false;
+  POM_JOB *job = &pomQueue[pomQueueCount++];
+  job->cab = cab;
+  job->cv = cv;
+  job->value = value;
+  job->bit = bit;
+  job->sendsLeft = POM_SENDS;
+  return true;
+}
 
-  DCCWaveform::mainTrack.schedulePacket(b, nB, 4);
+// Send the write at the head of the queue as a pair of packets (the decoder
+// acts on two identical packets in a row).  Each write is sent POM_SENDS 
+// times with other packets between, and then reported as complete.
+bool DCC::issuePOMPacket() {
+  POM_JOB *job = &pomQueue[0];
+  byte b[5];
+  byte nB;
+  if (job->bit == POM_BYTE)
+    nB = pomPacket(b, job->cab, job->cv, WRITE_BYTE_MAIN, job->value);
+  else
+    nB = pomPacket(b, job->cab, job->cv, WRITE_BIT_MAIN, 
+                   WRITE_BIT | ((job->bit & 0x08) ? BIT_ON : BIT_OFF) | (job->bit & 0x07));
+  DCCWaveform::mainTrack.schedulePacket(b, nB, 1);
+  if (--job->sendsLeft > 0) return true;
+
+  CommandDistributor::broadcastPOM(job->cab, job->cv, job->bit, job->value);
+  pomQueueCount--;
+  for (byte j=0; j<pomQueueCount; j++)
+    pomQueue[j] = pomQueue[j+1];
+  return true;
 }
 
 FSH* DCC::getMotorShieldName() {
@@ -574,15 +760,16 @@ void DCC::setLocoId(int id,ACK_CALLBACK callback) {
 }
 
 void DCC::forgetLoco(int cab) {  // removes any speed reminders for this loco
-  setThrottle2(cab,1); // ESTOP this loco if still on track
+  byte speedSteps=getSpeedSteps(cab);
+  setThrottle2(cab,1,speedSteps); // ESTOP this loco if still on track
   int reg=lookupSpeedTable(cab, false);
   if (reg>=0) {
     speedTable[reg].loco=0;
-    setThrottle2(cab,1); // ESTOP if this loco still on track
+    setThrottle2(cab,1,speedSteps); // ESTOP if this loco still on track
   }
 }
 void DCC::forgetAllLocos() {  // removes all speed reminders
-  setThrottle2(0,1); // ESTOP all locos still on track
+  setThrottle2(0,1,globalSpeedsteps); // ESTOP all locos still on track
   for (int i=0;i<MAX_LOCOS;i++) speedTable[i].loco=0;
 }
 
@@ -591,11 +778,18 @@ byte DCC::loopStatus=0;
 void DCC::loop()  {
   TrackManager::loop(); // power overload checks
   issueReminders();
+#ifdef LOCO_STORE_ACTIVE
+  LocoStore::loop();
+#endif
 }
 
 void DCC::issueReminders() {
   // if the main track transmitter still has a pending packet, skip this time around.
   if ( DCCWaveform::mainTrack.getPacketPending()) return;
+  // Accessory packets that are due go before loco reminders.
+  if (accessoryQueueCount > 0 && issueAccessoryPacket()) return;
+  // POM writes alternate with loco reminders.
+  if (pomQueueCount > 0 && (pomTurn = !pomTurn) && issuePOMPacket()) return;
   // Move to next loco slot.  If occupied, send a reminder.
   int reg = lastLocoReminder+1;
   if (reg > highestUsedReg) reg = 0;  // Go to start of table
@@ -615,7 +809,9 @@ bool DCC::issueReminder(int reg) {
   switch (loopStatus) {
         case 0:
       //   DIAG(F("Reminder %d speed %d"),loco,speedTable[reg].speedCode);
-         setThrottle2(loco, speedTable[reg].speedCode);
+         // consist members are reminded through the consist address
+         if (!(flags & CONSIST_MEMBER))
+           setThrottle2(loco, speedTable[reg].speedCode, speedStepsOf(reg));
          break;
        case 1: // remind function group 1 (F0-F4)
           if (flags & FN_GROUP_1)
@@ -683,6 +879,10 @@ int DCC::lookupSpeedTable(int locoId, bool autoCreate) {
         speedTable[reg].speedCode=128;  // default direction forward
         speedTable[reg].groupFlags=0;
         speedTable[reg].functions=0;
+        // a forgotten consist member must still be reminded via the consist
+        bool reversed;
+        if (lookupConsistMember(locoId, reversed)>=0)
+          speedTable[reg].groupFlags=CONSIST_MEMBER;
   }
   if (reg > highestUsedReg) highestUsedReg = reg;
   return reg;
@@ -729,3 +929,132 @@ void DCC::displayCabList(Print * stream) {
      StringFormatter::send(stream,F("Used=%d, max=%d\n"),used,MAX_LOCOS);
 
 }
+
+DCC::CONSIST DCC::consists[MAX_CONSISTS];
+DCC::ACCESSORY_PACKET DCC::accessoryQueue[ACCESSORY_QUEUE_SIZE];
+byte DCC::accessoryQueueCount=0;
+DCC::POM_JOB DCC::pomQueue[POM_QUEUE_SIZE];
+byte DCC::pomQueueCount=0;
+bool DCC::pomTurn=false;
+DCC::ACCESSORY_PULSE DCC::accessoryPulses[MAX_ACCESSORY_PULSES];
+byte DCC::accessoryPulseCount=0;
+
+// Set up an advanced consist. Each member has CV19 written on the main
+// track so that it responds to the consist address, with bit 7 set when
+// the member runs reversed. Members keep their own reminder slot for
+// functions but their speed is only sent to the consist address.
+bool DCC::setConsist(byte consist, int16_t members[], byte count) {
+  if (consist<1 || consist>HIGHEST_SHORT_ADDR) return false;
+  if (count<1 || count>MAX_CONSIST_MEMBERS) return false;
+  for (byte i=0;i<count;i++) {
+    int loco=abs(members[i]);
+    if (loco<1 || loco>10239 || loco==consist) return false;
+    bool reversed;
+    int other=lookupConsistMember(loco,reversed);
+    if (other>=0 && consists[other].address!=consist) return false; // already in another consist
+  }
+
+  int slot=lookupConsist(consist);
+  // Every CV19 write must be queued, or the decoders would disagree with
+  // the consist table.  Replacing a consist also clears the old members.
+  byte writes=count;
+  if (slot>=0) writes+=countConsistMembers(slot);
+  if (writes>getPOMQueueSpace()) return false;
+  if (slot>=0) removeConsist(consist);
+  else {
+    slot=lookupConsist(0);
+    if (slot<0) {
+      DIAG(F("Too many consists"));
+      return false;
+    }
+  }
+
+  consists[slot].address=consist;
+  byte speedCode=getThrottleSpeedByte(consist);
+  for (byte i=0;i<MAX_CONSIST_MEMBERS;i++) {
+    consists[slot].members[i]= i<count ? members[i] : 0;
+    if (i>=count) continue;
+    int loco=abs(members[i]);
+    writeCVByteMain(loco, 19, consist | (members[i]<0 ? 0x80 : 0));
+    int reg=lookupSpeedTable(loco);
+    if (reg>=0) speedTable[reg].groupFlags |= CONSIST_MEMBER;
+  }
+  updateLocoReminder(consist, speedCode);
+  updateConsistMembers(slot, speedCode);
+  return true;
+}
+
+// Remove an advanced consist, clearing CV19 on each member.
+// The members are left stopped at their own addresses.
+bool DCC::removeConsist(byte consist) {
+  int slot=lookupConsist(consist);
+  if (consist==0 || slot<0) return false;
+  if (countConsistMembers(slot)>getPOMQueueSpace()) return false;
+  // Stop the members through the consist address, which they still answer
+  // to until their CV19 writes go out.  This also sets their own reminders
+  // to stopped, so they stay stopped at their own addresses afterwards.
+  setThrottle(consist, 0, getThrottleDirection(consist));
+  forgetLoco(consist);
+  for (byte i=0;i<MAX_CONSIST_MEMBERS;i++) {
+    int loco=abs(consists[slot].members[i]);
+    if (loco==0) continue;
+    consists[slot].members[i]=0;
+    writeCVByteMain(loco, 19, 0);
+    int reg=lookupSpeedTable(loco, false);
+    if (reg>=0) speedTable[reg].groupFlags &= ~CONSIST_MEMBER;
+  }
+  consists[slot].address=0;
+  return true;
+}
+
+byte DCC::countConsistMembers(int slot) {
+  byte count=0;
+  for (byte i=0;i<MAX_CONSIST_MEMBERS;i++)
+    if (consists[slot].members[i]!=0) count++;
+  return count;
+}
+
+void DCC::displayConsists(Print * stream) {
+  for (byte slot=0;slot<MAX_CONSISTS;slot++) {
+    if (consists[slot].address==0) continue;
+    StringFormatter::send(stream,F("<C %d"),consists[slot].address);
+    for (byte i=0;i<MAX_CONSIST_MEMBERS;i++)
+      if (consists[slot].members[i]!=0)
+        StringFormatter::send(stream,F(" %d"),consists[slot].members[i]);
+    StringFormatter::send(stream,F(">\n"));
+  }
+}
+
+// returns consist slot using this address, or -1
+int DCC::lookupConsist(byte address) {
+  for (byte slot=0;slot<MAX_CONSISTS;slot++)
+    if (consists[slot].address==address) return slot;
+  return -1;
+}
+
+// returns consist slot this loco is a member of, or -1
+int DCC::lookupConsistMember(int loco, bool & reversed) {
+  if (loco<=0) return -1;
+  for (byte slot=0;slot<MAX_CONSISTS;slot++) {
+    if (consists[slot].address==0) continue;
+    for (byte i=0;i<MAX_CONSIST_MEMBERS;i++) {
+      int16_t member=consists[slot].members[i];
+      if (abs(member)==loco) {
+        reversed= member<0;
+        return slot;
+      }
+    }
+  }
+  return -1;
+}
+
+// Keep members' speed table entries in step with the consist so that
+// throttles showing individual members see consistent speed and direction.
+void DCC::updateConsistMembers(int consist, byte speedCode) {
+  for (byte i=0;i<MAX_CONSIST_MEMBERS;i++) {
+    int16_t member=consists[consist].members[i];
+    if (member==0) continue;
+    byte memberCode= member<0 ? speedCode ^ 0x80 : speedCode;
+    updateLocoReminder(abs(member), memberCode);
+  }
+}
@@ -47,6 +47,40 @@ const byte MAX_LOCOS = 50;
 #else
 const byte MAX_LOCOS = 30;
 #endif
+// Advanced consists (CV19), each driven by a single consist address
+#if defined(HAS_ENOUGH_MEMORY)
+const byte MAX_CONSISTS = 8;
+#else
+const byte MAX_CONSISTS = 2;
+#endif
+const byte MAX_CONSIST_MEMBERS = 4;
+// Accessory packets waiting to be sent, and accessories with their own pulse time
+#if defined(HAS_ENOUGH_MEMORY)
+const byte ACCESSORY_QUEUE_SIZE = 16;
+const byte MAX_ACCESSORY_PULSES = 16;
+#else
+const byte ACCESSORY_QUEUE_SIZE = 8;
+const byte MAX_ACCESSORY_PULSES = 4;
+#endif
+// Main track (POM) CV writes waiting to be sent
+#if defined(HAS_ENOUGH_MEMORY)
+const byte POM_QUEUE_SIZE = 32;
+#else
+const byte POM_QUEUE_SIZE = 8;
+#endif
+// The 'bit' of a queued POM write for a whole byte, otherwise the bit
+// number | bit value<<3.
+const byte POM_BYTE = 0xff;
+// Number of times each POM write is sent as a pair of packets, with other
+// traffic between.  The default of 2 gives the 4 packets sent previously.
+#ifndef POM_SENDS
+#define POM_SENDS 2
+#endif
+// Default time between the "on" and "off" packets of an accessory (ms).
+// Zero sends the "off" packet straight after the "on" packet as before.
+#ifndef ACCESSORY_PULSE_MS
+#define ACCESSORY_PULSE_MS 0
+#endif
 
 class DCC
 {
@@ -62,8 +96,10 @@ public:
   static int8_t getThrottleSpeed(int cab);
   static uint8_t getThrottleSpeedByte(int cab);
   static bool getThrottleDirection(int cab);
-  static void writeCVByteMain(int cab, int cv, byte bValue);
-  static void writeCVBitMain(int cab, int cv, byte bNum, bool bValue);
+  static bool writeCVByteMain(int cab, int cv, byte bValue);
+  static bool writeCVBitMain(int cab, int cv, byte bNum, bool bValue);
+  static inline bool isPOMQueueFull() { return pomQueueCount >= POM_QUEUE_SIZE; }
+  static inline byte getPOMQueueSpace() { return POM_QUEUE_SIZE - pomQueueCount; }
   static void setFunction(int cab, byte fByte, byte eByte);
   static bool setFn(int cab, int16_t functionNumber, bool on);
   static void changeFn(int cab, int16_t functionNumber);
@@ -71,6 +107,8 @@ public:
   static uint32_t getFunctionMap(int cab);
   static void updateGroupflags(byte &flags, int16_t functionNumber);
   static void setAccessory(int address, byte port, bool gate, byte onoff = 2);
+  static bool setExtendedAccessory(int16_t address, byte aspect);
+  static bool setAccessoryPulse(int address, byte port, uint16_t pulseMs);
   static bool writeTextPacket(byte *b, int nBytes);
   
   // ACKable progtrack calls  bitresults callback 0,0 or -1, cv returns value or -1
@@ -88,10 +126,18 @@ public:
   static void forgetLoco(int cab); // removes any speed reminders for this loco
   static void forgetAllLocos();    // removes all speed reminders
   static void displayCabList(Print *stream);
+
+  // Advanced consist API. Members are loco ids, negative if running reversed.
+  static bool setConsist(byte consist, int16_t members[], byte count);
+  static bool removeConsist(byte consist);
+  static void displayConsists(Print *stream);
   static FSH *getMotorShieldName();
   static inline void setGlobalSpeedsteps(byte s) {
     globalSpeedsteps = s;
   };
+  // Per-loco speed step mode (14, 28 or 128, 0 = use global setting)
+  static bool setSpeedSteps(int cab, byte speedSteps);
+  static byte getSpeedSteps(int cab);
   
   struct LOCO
   {
@@ -107,7 +153,8 @@ public:
  
 private:
   static byte loopStatus;
-  static void setThrottle2(uint16_t cab, uint8_t speedCode);
+  static void setThrottle2(uint16_t cab, uint8_t speedCode, byte speedSteps);
+  static byte speedStepsOf(int reg);
   static void updateLocoReminder(int loco, byte speedCode);
   static void setFunctionInternal(int cab, byte fByte, byte eByte);
   static bool issueReminder(int reg);
@@ -117,6 +164,57 @@ private:
   static byte globalSpeedsteps;
 
   static void issueReminders();
+
+  // Accessory packets are queued, and sent from loop() when they fall due
+  // so that "off" packets can follow after the accessory's pulse time.
+  // An "off" packet waits until its "on" packet (the entry before it) has
+  // been sent, and only then is its due time set.
+  struct ACCESSORY_PACKET
+  {
+    byte packet[3];
+    byte length;
+    bool waiting;   // waiting for the previous entry, due holds the pulse time
+    uint16_t due;   // low 16 bits of millis() when packet can be sent
+  };
+  static ACCESSORY_PACKET accessoryQueue[ACCESSORY_QUEUE_SIZE];
+  static byte accessoryQueueCount;
+  static void queueAccessoryPacket(byte *packet, byte length, bool afterPrevious, uint16_t delayMs);
+  static bool issueAccessoryPacket();
+  struct ACCESSORY_PULSE
+  {
+    uint16_t packedAddress;  // address<<2 | port
+    uint16_t pulseMs;
+  };
+  static ACCESSORY_PULSE accessoryPulses[MAX_ACCESSORY_PULSES];
+  static byte accessoryPulseCount;
+
+  // POM writes are queued, and sent from loop() in turn with the loco
+  // reminders so that a batch of writes doesn't hold up other traffic.
+  struct POM_JOB
+  {
+    int16_t cab;
+    int16_t cv;
+    byte value;
+    byte bit;        // POM_BYTE, or bit number | bit value<<3 for bit writes
+    byte sendsLeft;
+  };
+  static POM_JOB pomQueue[POM_QUEUE_SIZE];
+  static byte pomQueueCount;
+  static bool pomTurn;
+  static bool queuePOM(int cab, int cv, byte value, byte bit);
+  static bool issuePOMPacket();
+  static byte pomPacket(byte *b, int cab, int cv, byte opcode, byte value);
+
+  struct CONSIST
+  {
+    byte address;  // consist address 1-127, 0 if unused
+    int16_t members[MAX_CONSIST_MEMBERS]; // 0 if unused, negative if reversed
+  };
+  static CONSIST consists[MAX_CONSISTS];
+  static int lookupConsist(byte address);
+  static int lookupConsistMember(int loco, bool &reversed);
+  static byte countConsistMembers(int slot);
+  static void updateConsistMembers(int consist, byte speedCode);
   static void callback(int value);
 
   
@@ -45,11 +45,11 @@ Once a new OPCODE is decided upon, update this list.
   0, Track power off
   1, Track power on
   a, DCC accessory control
-  A,
+  A, DCC extended accessory control
   b, Write CV bit on main
   B, Write CV bit
   c, Request current command
-  C,
+  C, Advanced consist control
   d,
   D, Diagnostic commands
   e, Erase EEPROM
@@ -114,6 +114,8 @@ Once a new OPCODE is decided upon, update this list.
 #include "TrackManager.h"
 #include "DCCTimer.h"
 #include "EXRAIL2.h"
+#include "SerialManager.h"
+#include "LocoStore.h"
 
 // This macro can't be created easily as a portable function because the
 // flashlist requires a far pointer for high flash access. 
@@ -150,6 +152,7 @@ const int16_t HASH_KEYWORD_RESET = 26133;
 const int16_t HASH_KEYWORD_RETRY = 25704;
 const int16_t HASH_KEYWORD_SPEED28 = -17064;
 const int16_t HASH_KEYWORD_SPEED128 = 25816;
+const int16_t HASH_KEYWORD_SPEED14 = -17078;
 const int16_t HASH_KEYWORD_SERVO=27709;
 const int16_t HASH_KEYWORD_TT=2688;
 const int16_t HASH_KEYWORD_VPIN=-415;
@@ -168,6 +171,12 @@ const int16_t HASH_KEYWORD_ANOUT = -26399;
 const int16_t HASH_KEYWORD_WIFI = -5583;
 const int16_t HASH_KEYWORD_ETHERNET = -30767;
 const int16_t HASH_KEYWORD_WIT = 31594;
+const int16_t HASH_KEYWORD_RECORD = 9389;
+const int16_t HASH_KEYWORD_START = 23232;
+const int16_t HASH_KEYWORD_STOP = 22744;
+const int16_t HASH_KEYWORD_ACCPULSE = 13086;
+const int16_t HASH_KEYWORD_RAILCOM = -29097;
+const int16_t HASH_KEYWORD_SERIAL = -8896;
 
 int16_t DCCEXParser::stashP[MAX_COMMAND_PARAMS];
 bool DCCEXParser::stashBusy;
@@ -271,7 +280,7 @@ void DCCEXParser::parse(const FSH * cmd) {
       int size=STRLEN_P((char *)cmd)+1; 
       char buffer[size];
       STRCPY_P(buffer,(char *)cmd);
-      parse(&USB_SERIAL,(byte *)buffer,NULL);
+      parse(SerialManager::output(&USB_SERIAL),(byte *)buffer,NULL);
 }
 
 // See documentation on DCC class for info on this section
@@ -280,6 +289,8 @@ void DCCEXParser::parse(Print *stream,  byte *com,  RingStream *ringStream) {
   // This function can get stings of the form "<C OMM AND>" or "C OMM AND"
   // found is true first after the leading "<" has been passed
   bool found = (com[0] != '<');
+  if (Diag::RECORD)
+    DIAG(F("REC %l X %d %e"), millis(), ringStream ? ringStream->peekTargetMark() : 255, com);
   for (byte *c=com; c[0] != '\0'; c++) {
     if (found) {
       parseOne(stream, c,  ringStream);
@@ -420,6 +431,11 @@ void DCCEXParser::parseOne(Print *stream, byte *com, RingStream * ringStream)
         }
         return;
      
+    case 'A': // EXTENDED ACCESSORY <A ADDRESS ASPECT>
+        if (params!=2 || (p[1] & 0xFF) != p[1]) break;
+        if (!DCC::setExtendedAccessory(p[0], p[1])) break;
+        return;
+
     case 'T': // TURNOUT  <T ...>
         if (parseT(stream, params, p))
             return;
@@ -444,18 +460,27 @@ void DCCEXParser::parseOne(Print *stream, byte *com, RingStream * ringStream)
             return;
         break;
 
+    case 'C': // CONSIST <C ...>
+        if (parseC(stream, params, p))
+            return;
+        break;
+
     case 'S': // SENSOR <S ...>
         if (parseS(stream, params, p))
             return;
         break;
 
 #ifndef DISABLE_PROG
-    case 'w': // WRITE CV on MAIN <w CAB CV VALUE>
-        DCC::writeCVByteMain(p[0], p[1], p[2]);
+    case 'w': // WRITE CV on MAIN <w CAB CV VALUE [CV VALUE ...]>
+        if (params<3 || (params & 1)==0) break;
+        // The whole list is queued or none of it is (reply <X>)
+        if ((params-1)/2 > DCC::getPOMQueueSpace()) break;
+        for (byte i=1; i<params; i+=2)
+            DCC::writeCVByteMain(p[0], p[i], p[i+1]);
         return;
 
     case 'b': // WRITE CV BIT ON MAIN <b CAB CV BIT VALUE>
-        DCC::writeCVBitMain(p[0], p[1], p[2], p[3]);
+        if (!DCC::writeCVBitMain(p[0], p[1], p[2], p[3])) break;
         return;
 #endif
 
@@ -678,6 +703,13 @@ void DCCEXParser::parseOne(Print *stream, byte *com, RingStream * ringStream)
 
     case 'J' : // throttle info access
         {
+#ifdef LOCO_STORE_ACTIVE
+            // <JR id "name" "functions"> adds a runtime roster entry
+            if (p[0]==HASH_KEYWORD_R && strchr((char *)com,'"')) {
+                if (parseRosterEntry(p[1], com)) return;
+                break;
+            }
+#endif
             if ((params<1) | (params>3)) break; // <J>
             //if ((params<1) | (params>2)) break; // <J>
             int16_t id=(params==2)?p[1]:0;
@@ -688,6 +720,11 @@ void DCCEXParser::parseOne(Print *stream, byte *com, RingStream * ringStream)
                         StringFormatter::send(stream, F("<jC %d>\n"), x);
                         return;
                     }
+                    if (params==2) { // <JC START> or <JC STOP> internal fast clock
+                        if (p[1]!=HASH_KEYWORD_START && p[1]!=HASH_KEYWORD_STOP) break;
+                        CommandDistributor::startFastClock(p[1]==HASH_KEYWORD_START);
+                        return;
+                    }
                     CommandDistributor::setClockTime(p[1], p[2], 1);
                     return;
                 
@@ -724,6 +761,26 @@ void DCCEXParser::parseOne(Print *stream, byte *com, RingStream * ringStream)
                     return; 
             case HASH_KEYWORD_R: // <JR> returns rosters 
                 StringFormatter::send(stream, F("<jR"));
+#ifdef LOCO_STORE_ACTIVE
+                if (params==1) {
+                    for (byte i=0; i<LOCO_STORE_ROSTER; i++) {
+                        int16_t rosterId=LocoStore::getRosterId(i);
+#ifdef EXRAIL_ACTIVE
+                        if (RMFT2::getRosterName(rosterId)) continue; // listed below
+#endif
+                        if (rosterId>0) StringFormatter::send(stream,F(" %d"),rosterId);
+                    }
+                }
+                else {
+                    char rosterName[LOCO_STORE_NAME_SIZE];
+                    char functionNames[LOCO_STORE_FUNCTIONS_SIZE];
+                    if (LocoStore::getRoster(id, rosterName, functionNames)) {
+                        StringFormatter::send(stream,F(" %d \"%s\" \"%s\">\n"), 
+                                              id, rosterName, functionNames);
+                        return;
+                    }
+                }
+#endif
 #ifdef EXRAIL_ACTIVE
                 if (params==1) {
                     SENDFLASHLIST(stream,RMFT2::rosterIdList)
@@ -828,6 +885,33 @@ bool DCCEXParser::parseZ(Print *stream, int16_t params, int16_t p[])
     }
 }
 
+//===================================
+bool DCCEXParser::parseC(Print *stream, int16_t params, int16_t p[])
+{
+    switch (params)
+    {
+    case 0: // <C> list consists
+        DCC::displayConsists(stream);
+        return true;
+
+    case 1: // <C CONSIST> remove consist
+        if (p[0] < 1 || p[0] > HIGHEST_SHORT_ADDR)
+            return false;
+        if (!DCC::removeConsist(p[0]))
+            return false;
+        StringFormatter::send(stream, F("<O>\n"));
+        return true;
+
+    default: // <C CONSIST LOCO LOCO ...> members negative if reversed
+        if (params - 1 > MAX_CONSIST_MEMBERS || p[0] < 1 || p[0] > HIGHEST_SHORT_ADDR)
+            return false;
+        if (!DCC::setConsist(p[0], p + 1, params - 1))
+            return false;
+        StringFormatter::send(stream, F("<O>\n"));
+        return true;
+    }
+}
+
 //===================================
 bool DCCEXParser::parsef(Print *stream, int16_t params, int16_t p[])
 {
@@ -976,6 +1060,24 @@ bool DCCEXParser::parseS(Print *stream, int16_t params, int16_t p[])
     return false;
 }
 
+#ifdef LOCO_STORE_ACTIVE
+// <JR id "name" "functions"> stores a roster entry, <JR id ""> removes it.
+// The quoted strings are terminated in place in the command buffer.
+bool DCCEXParser::parseRosterEntry(int16_t id, byte * com)
+{
+    char * strings[2] = {NULL, NULL};
+    char * c = strchr((char *)com, '"');
+    for (byte n = 0; n < 2 && c; n++) {
+        strings[n] = ++c;
+        c = strchr(c, '"');
+        if (!c) return false; // unterminated string
+        *c++ = '\0';
+        c = strchr(c, '"');
+    }
+    return LocoStore::setRoster(id, strings[0], strings[1] ? strings[1] : "");
+}
+#endif
+
 bool DCCEXParser::parseD(Print *stream, int16_t params, int16_t p[])
 {
     if (params == 0)
@@ -1018,6 +1120,12 @@ bool DCCEXParser::parseD(Print *stream, int16_t params, int16_t p[])
         Diag::CMD = onOff;
         return true;
 
+    case HASH_KEYWORD_RECORD: // <D RECORD ON/OFF>
+        // Log inbound commands, sensor changes and clock ticks as
+        // "REC millis type id data" lines so a session can be replayed.
+        Diag::RECORD = onOff;
+        return true;
+
 #ifdef HAS_ENOUGH_MEMORY
     case HASH_KEYWORD_WIFI: // <D WIFI ON/OFF>
         Diag::WIFI = onOff;
@@ -1052,14 +1160,19 @@ bool DCCEXParser::parseD(Print *stream, int16_t params, int16_t p[])
 	return true;
 #endif
 
-    case HASH_KEYWORD_SPEED28:
-        DCC::setGlobalSpeedsteps(28);
-	StringFormatter::send(stream, F("28 Speedsteps"));
-        return true;
-
-    case HASH_KEYWORD_SPEED128:
-        DCC::setGlobalSpeedsteps(128);
-	StringFormatter::send(stream, F("128 Speedsteps"));
+    case HASH_KEYWORD_SPEED14:  // <D SPEED14 [cab]>
+    case HASH_KEYWORD_SPEED28:  // <D SPEED28 [cab]>
+    case HASH_KEYWORD_SPEED128: // <D SPEED128 [cab]>
+        {
+          byte speedSteps = (p[0]==HASH_KEYWORD_SPEED14) ? 14 : (p[0]==HASH_KEYWORD_SPEED28) ? 28 : 128;
+          if (params > 1) { // per-loco setting
+            if (!DCC::setSpeedSteps(p[1], speedSteps)) return false;
+            StringFormatter::send(stream, F("%d Speedsteps for loco %d"), speedSteps, p[1]);
+          } else {
+            DCC::setGlobalSpeedsteps(speedSteps);
+            StringFormatter::send(stream, F("%d Speedsteps"), speedSteps);
+          }
+        }
         return true;
 
     case HASH_KEYWORD_SERVO:  // <D SERVO vpin position [profile]>
@@ -1080,6 +1193,17 @@ bool DCCEXParser::parseD(Print *stream, int16_t params, int16_t p[])
         break;
 #endif
 
+    case HASH_KEYWORD_RAILCOM: // <D RAILCOM ON/OFF>
+        return DCCWaveform::setRailcom(onOff);
+
+    case HASH_KEYWORD_SERIAL: // <D SERIAL>
+        SerialManager::showStatus(stream);
+        return true;
+
+    case HASH_KEYWORD_ACCPULSE:  // <D ACCPULSE linearaddress ms>
+        if (params!=3 || p[1] < 1) break;
+        return DCC::setAccessoryPulse((p[1] - 1) / 4 + 1, (p[1] - 1) % 4, p[2]);
+
     case HASH_KEYWORD_TT:     // <D TT vpin steps activity>
         IODevice::writeAnalogue(p[1], p[2], params>3 ? p[3] : 0);
         break;
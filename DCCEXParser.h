@@ -46,9 +46,11 @@ struct DCCEXParser
      
     static bool parseT(Print * stream, int16_t params, int16_t p[]);
      static bool parseZ(Print * stream, int16_t params, int16_t p[]);
+     static bool parseC(Print * stream, int16_t params, int16_t p[]);
      static bool parseS(Print * stream,  int16_t params, int16_t p[]);
      static bool parsef(Print * stream,  int16_t params, int16_t p[]);
      static bool parseD(Print * stream,  int16_t params, int16_t p[]);
+    static bool parseRosterEntry(int16_t id, byte * com);
 
      static Print * getAsyncReplyStream();
      static void commitAsyncReplyStream();
@@ -29,6 +29,9 @@
 #define RMT_CLOCK_DIVIDER 80
 #define DCC_1_HALFPERIOD 58  //4640 // 1 / 80000000 * 4640 = 58us
 #define DCC_0_HALFPERIOD 100 //8000
+#if DCC_1_HALFPERIOD < 55 || DCC_1_HALFPERIOD > 61 || DCC_0_HALFPERIOD < 95
+#error DCC bit timing outside NMRA S-9.1 limits
+#endif
 
 class RMTChannel {
  public:
@@ -88,6 +88,9 @@ private:
   static int freeMemory();
   static volatile int minimum_free_memory;
   static const int DCC_SIGNAL_TIME=58;  // this is the 58uS DCC 1-bit waveform half-cycle 
+  // NMRA S-9.1: a "1" half-bit must be 55-61uS.  A "0" is sent as two
+  // timer periods so it is comfortably inside the 95-9900uS window.
+  static_assert(DCC_SIGNAL_TIME >= 55 && DCC_SIGNAL_TIME <= 61, "NMRA S-9.1: 1-bit half period out of range");
 #if defined(ARDUINO_ARCH_STM32)  // TODO: PMA temporary hack - assumes 100Mhz F_CPU as STM32 can change frequency
   static const long CLOCK_CYCLES=(100000000L / 1000000 * DCC_SIGNAL_TIME) >>1;
 #else
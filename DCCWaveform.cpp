@@ -50,7 +50,9 @@ const WAVE_STATE stateTransform[]={
    /* WAVE_HIGH_0  -> */ WAVE_MID_0,
    /* WAVE_MID_0   -> */ WAVE_LOW_0,
    /* WAVE_LOW_0   -> */ WAVE_START,
-   /* WAVE_PENDING (should not happen) -> */ WAVE_PENDING};
+   /* WAVE_PENDING (should not happen) -> */ WAVE_PENDING,
+   /* WAVE_MID_1_CUTOUT -> */ WAVE_CUTOUT,
+   /* WAVE_CUTOUT (ended by interruptHandler) -> */ WAVE_CUTOUT};
 
 // For each state of the wave, signal pin is HIGH or LOW   
 const bool signalTransform[]={
@@ -59,14 +61,20 @@ const bool signalTransform[]={
    /* WAVE_HIGH_0  -> */ HIGH,
    /* WAVE_MID_0   -> */ LOW,
    /* WAVE_LOW_0   -> */ LOW,
-   /* WAVE_PENDING (should not happen) -> */ LOW};
+   /* WAVE_PENDING (should not happen) -> */ LOW,
+   /* WAVE_MID_1_CUTOUT -> */ LOW,
+   /* WAVE_CUTOUT (signal not used) -> */ LOW};
+
+volatile bool DCCWaveform::railcomActive = false;
 
 void DCCWaveform::begin() {
   DCCTimer::begin(DCCWaveform::interruptHandler);     
 }
 
 void DCCWaveform::loop() {
- // empty placemarker in case ESP32 needs something here 
+#if defined(DIAG_PACKETS)
+  reportPackets();
+#endif
 }
 
 #pragma GCC push_options
@@ -75,11 +83,26 @@ void DCCWaveform::interruptHandler() {
   // call the timer edge sensitive actions for progtrack and maintrack
   // member functions would be cleaner but have more overhead
   byte sigMain=signalTransform[mainTrack.state];
-  byte sigProg=TrackManager::progTrackSyncMain? sigMain : signalTransform[progTrack.state];
+  // A prog track joined to main follows main, including the cutout
+  bool joined=TrackManager::progTrackSyncMain;
   
   // Set the signal state for both tracks
-  TrackManager::setDCCSignal(sigMain);
-  TrackManager::setPROGSignal(sigProg);
+  if (mainTrack.state==WAVE_CUTOUT) {
+    // RailCom cutout: outputs shorted for RAILCOM_CUTOUT_TICKS, then
+    // carry on with the high half of the next preamble bit.
+    if (mainTrack.cutoutTicks==RAILCOM_CUTOUT_TICKS) TrackManager::setCutout(true);
+    if (mainTrack.cutoutTicks==0) {
+      TrackManager::setCutout(false);
+      TrackManager::setDCCSignal(HIGH);
+      if (joined) TrackManager::setPROGSignal(HIGH);
+      mainTrack.state=WAVE_START;
+    } else 
+      mainTrack.cutoutTicks--;
+  } else {
+    TrackManager::setDCCSignal(sigMain);
+    if (joined) TrackManager::setPROGSignal(sigMain);
+  }
+  if (!joined) TrackManager::setPROGSignal(signalTransform[progTrack.state]);
 
   // Refresh the values in the ADCee object buffering the values of the ADC HW
   ADCee::scan();
@@ -125,7 +148,12 @@ void DCCWaveform::interrupt2() {
   //        or WAVE_HIGH_0 for a 0 bit.
 
   if (remainingPreambles > 0 ) {
-    state=WAVE_MID_1;  // switch state to trigger LOW on next interrupt
+    if (remainingPreambles == requiredPreambles && isMainTrack && railcomActive) {
+      // This is the packet end bit, so follow it with the RailCom cutout.
+      state=WAVE_MID_1_CUTOUT;
+      cutoutTicks=RAILCOM_CUTOUT_TICKS;
+    } else
+      state=WAVE_MID_1;  // switch state to trigger LOW on next interrupt
     remainingPreambles--;
     // Update free memory diagnostic as we don't have anything else to do this time.
     // Allow for checkAck and its called functions using 22 bytes more.
@@ -179,6 +207,9 @@ void DCCWaveform::interrupt2() {
 // Wait until there is no packet pending, then make this pending
 void DCCWaveform::schedulePacket(const byte buffer[], byte byteCount, byte repeats) {
   if (byteCount > MAX_PACKET_SIZE) return; // allow for chksum
+#if defined(DIAG_PACKETS)
+  countPacket(buffer, byteCount, repeats);
+#endif
   while (packetPending);
 
   byte checksum = 0;
@@ -196,6 +227,11 @@ void DCCWaveform::schedulePacket(const byte buffer[], byte byteCount, byte repea
 bool DCCWaveform::getPacketPending() {
   return packetPending;
 }
+
+bool DCCWaveform::setRailcom(bool on) {
+  railcomActive = on;
+  return true;
+}
 #endif
 
 #ifdef ARDUINO_ARCH_ESP32
@@ -237,6 +273,9 @@ void DCCWaveform::begin() {
 
 void DCCWaveform::schedulePacket(const byte buffer[], byte byteCount, byte repeats) {
   if (byteCount > MAX_PACKET_SIZE) return; // allow for chksum
+#if defined(DIAG_PACKETS)
+  countPacket(buffer, byteCount, repeats);
+#endif
   
   byte checksum = 0;
   for (byte b = 0; b < byteCount; b++) {
@@ -277,7 +316,126 @@ bool DCCWaveform::getPacketPending() {
     return rmtProgChannel->busy();
   }
 }
+
+bool DCCWaveform::setRailcom(bool on) {
+  // The RMT channels don't generate a cutout.
+  (void)on;
+  return false;
+}
 void IRAM_ATTR DCCWaveform::loop() {
   DCCACK::checkAck(progTrack.getResets());
+#if defined(DIAG_PACKETS)
+  reportPackets();
+#endif
+}
+#endif
+
+#if defined(DIAG_PACKETS)
+#include "DCC.h"
+#include "DIAG.h"
+
+// Packet classes as identified from the address and instruction bytes
+// (NMRA S-9.2.1).  Counts include repeats, i.e. packets put on the rails.
+enum : byte {
+  PKT_BROADCAST, PKT_SPEED, PKT_FUNCTION, PKT_CV, PKT_ACCESSORY, PKT_OTHER, PKT_BAD,
+  PKT_CLASSES };
+static unsigned long packetCounts[PKT_CLASSES];
+static unsigned long progPacketCount = 0;
+static struct {
+  int loco;
+  unsigned long count;
+} locoPacketCounts[MAX_LOCOS];
+static unsigned long lastPacketReport = 0;
+
+void DCCWaveform::countPacket(const byte buffer[], byte byteCount, byte repeats) {
+  unsigned long weight = repeats + 1;
+  if (!isMainTrack) {
+    progPacketCount += weight;
+    return;
+  }
+  // Smallest valid packet is one address byte plus one instruction byte
+  // (the checksum is added by schedulePacket).
+  if (byteCount < 2) {
+    packetCounts[PKT_BAD] += weight;
+    return;
+  }
+  byte b0 = buffer[0];
+  int loco = 0;
+  byte instruction = 1;   // index of the instruction byte
+  if (b0 == 0x00 || b0 == 0xFF) {
+    packetCounts[PKT_BROADCAST] += weight;
+    return;
+  } else if (b0 <= 127) {
+    loco = b0;
+  } else if (b0 <= 191) {
+    packetCounts[PKT_ACCESSORY] += weight;
+    return;
+  } else if (b0 <= 231) {
+    loco = ((b0 & 0x3F) << 8) | buffer[1];
+    instruction = 2;
+    if (byteCount < 3) {
+      packetCounts[PKT_BAD] += weight;
+      return;
+    }
+  } else {
+    packetCounts[PKT_OTHER] += weight;
+    return;
+  }
+
+  byte op = buffer[instruction];
+  switch (op >> 5) {
+  case 0b001: // advanced operations (128 step speed)
+  case 0b010: // speed and direction
+  case 0b011:
+    packetCounts[PKT_SPEED] += weight;
+    break;
+  case 0b100: // function group one
+  case 0b101: // function group two
+  case 0b110: // feature expansion (F13-F28, binary states)
+    packetCounts[PKT_FUNCTION] += weight;
+    break;
+  case 0b111: // CV access (POM)
+    packetCounts[PKT_CV] += weight;
+    break;
+  default:    // decoder and consist control
+    packetCounts[PKT_OTHER] += weight;
+    break;
+  }
+
+  // Keep a per-loco count, using the first free slot for a new address.
+  int freeSlot = -1;
+  for (int slot = 0; slot < MAX_LOCOS; slot++) {
+    if (locoPacketCounts[slot].loco == loco) {
+      locoPacketCounts[slot].count += weight;
+      return;
+    }
+    if (freeSlot < 0 && locoPacketCounts[slot].loco == 0) freeSlot = slot;
+  }
+  if (freeSlot >= 0) {
+    locoPacketCounts[freeSlot].loco = loco;
+    locoPacketCounts[freeSlot].count = weight;
+  }
+}
+
+// Report packet rates (per second) every 5 seconds, then clear the counts.
+void DCCWaveform::reportPackets() {
+  unsigned long now = millis();
+  unsigned long elapsed = now - lastPacketReport;
+  if (elapsed < 5000UL) return;
+  lastPacketReport = now;
+  DIAG(F("Packets/s bcast:%l speed:%l fn:%l cv:%l acc:%l other:%l bad:%l prog:%l"),
+    packetCounts[PKT_BROADCAST] * 1000 / elapsed, packetCounts[PKT_SPEED] * 1000 / elapsed,
+    packetCounts[PKT_FUNCTION] * 1000 / elapsed, packetCounts[PKT_CV] * 1000 / elapsed,
+    packetCounts[PKT_ACCESSORY] * 1000 / elapsed, packetCounts[PKT_OTHER] * 1000 / elapsed,
+    packetCounts[PKT_BAD] * 1000 / elapsed, progPacketCount * 1000 / elapsed);
+  for (int slot = 0; slot < MAX_LOCOS; slot++) {
+    if (locoPacketCounts[slot].loco == 0) continue;
+    // rate in packets per 10 seconds so that slow reminder rates still show
+    DIAG(F("Packets loco=%d rate=%l/10s"), locoPacketCounts[slot].loco,
+      locoPacketCounts[slot].count * 10000 / elapsed);
+    locoPacketCounts[slot].loco = 0;
+  }
+  for (byte c = 0; c < PKT_CLASSES; c++) packetCounts[c] = 0;
+  progPacketCount = 0;
 }
 #endif
@@ -30,17 +30,32 @@
 #include "TrackManager.h"
 #endif
 
-
+// Define symbol DIAG_PACKETS to enable a periodic report of the packets
+// scheduled for each track (packet mix, malformed packets and rate per loco).
+//#define DIAG_PACKETS
 
 // Number of preamble bits.
 const int   PREAMBLE_BITS_MAIN = 16;
 const int   PREAMBLE_BITS_PROG = 22;
 const byte   MAX_PACKET_SIZE = 5;  // NMRA standard extended packets, payload size WITHOUT checksum.
 
+// NMRA S-9.2 requires at least 14 preamble bits in operations mode and
+// S-9.2.3 at least 20 in service mode.
+static_assert(PREAMBLE_BITS_MAIN >= 14, "NMRA S-9.2: main track preamble must be 14 bits or more");
+static_assert(PREAMBLE_BITS_PROG >= 20, "NMRA S-9.2.3: prog track preamble must be 20 bits or more");
+
 
 // The WAVE_STATE enum is deliberately numbered because a change of order would be catastrophic
 // to the transform array.
-enum  WAVE_STATE : byte {WAVE_START=0,WAVE_MID_1=1,WAVE_HIGH_0=2,WAVE_MID_0=3,WAVE_LOW_0=4,WAVE_PENDING=5};
+enum  WAVE_STATE : byte {WAVE_START=0,WAVE_MID_1=1,WAVE_HIGH_0=2,WAVE_MID_0=3,WAVE_LOW_0=4,WAVE_PENDING=5,
+                        WAVE_MID_1_CUTOUT=6,WAVE_CUTOUT=7};
+
+// RailCom cutout (NMRA S-9.3.2) on the main track, in timer ticks of 58us.
+// The cutout starts at the end of the packet end bit and lasts 8 ticks 
+// (464us, within the 454-488us window).  With the 58us timer resolution it
+// starts at the earliest point rather than the nominal 26-32us after the
+// end bit.  The preamble bits after the cutout are sent in full.
+const byte RAILCOM_CUTOUT_TICKS = 8;
 
 // NOTE: static functions are used for the overall controller, then
 // one instance is created for each track.
@@ -77,8 +92,15 @@ class DCCWaveform {
 #endif
     void schedulePacket(const byte buffer[], byte byteCount, byte repeats);
     bool getPacketPending();
+    // Enable or disable the RailCom cutout on the main track.  Returns false
+    // if not supported.
+    static bool setRailcom(bool on);
     
   private:
+#if defined(DIAG_PACKETS)
+    void countPacket(const byte buffer[], byte byteCount, byte repeats);
+    static void reportPackets();
+#endif
 #ifndef ARDUINO_ARCH_ESP32
     volatile bool packetPending;
     volatile byte sentResetsSincePacket;
@@ -87,6 +109,10 @@ class DCCWaveform {
 #endif
     static void interruptHandler();
     void interrupt2();
+#ifndef ARDUINO_ARCH_ESP32
+    static volatile bool railcomActive;
+    byte cutoutTicks = 0;       // remaining ticks of RailCom cutout
+#endif
     
     bool isMainTrack;
     // Transmission controller
@@ -30,6 +30,7 @@
 #include "Outputs.h"
 #include "Sensors.h"
 #include "Turnouts.h"
+#include "LocoStore.h"
 
 #if defined(ARDUINO_ARCH_SAMC)
 ExternalEEPROM EEPROM;
@@ -82,7 +83,13 @@ void EEStore::store() {
   Sensor::store();
   Output::store();
   EEPROM.put(0, eeStore->data);
+#ifdef LOCO_STORE_ACTIVE
+  DIAG(F("EEPROM used: %d/%d bytes"), EEStore::pointer(), LocoStore::base());
+  if (EEStore::pointer() > LocoStore::base())
+    DIAG(F("EEPROM overflows into LocoStore"));
+#else
   DIAG(F("EEPROM used: %d/%d bytes"), EEStore::pointer(), EEPROM.length());
+#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -52,6 +52,7 @@
 #include "Turnouts.h"
 #include "CommandDistributor.h"
 #include "TrackManager.h"
+#include "SerialManager.h"
 
 // Command parsing keywords
 const int16_t HASH_KEYWORD_EXRAIL=15435;    
@@ -69,6 +70,22 @@ const int16_t HASH_KEYWORD_ROUTES=-3702;
 const int16_t HASH_KEYWORD_RED=26099;
 const int16_t HASH_KEYWORD_AMBER=18713;
 const int16_t HASH_KEYWORD_GREEN=-31493;
+const int16_t HASH_KEYWORD_REG=26096;
+const int16_t HASH_KEYWORD_POST=888;
+const int16_t HASH_KEYWORD_VALIDATE=-16058;
+const int16_t HASH_KEYWORD_BREAK=9151;
+const int16_t HASH_KEYWORD_OP=2687;
+const int16_t HASH_KEYWORD_SUSPEND=-28310;
+const int16_t HASH_KEYWORD_STEP=22418;
+const int16_t HASH_KEYWORD_DUMP=31276;
+const int16_t HASH_KEYWORD_IMAGE=17223;
+const int16_t HASH_KEYWORD_LOAD=28070;
+const int16_t HASH_KEYWORD_SWAP=19349;
+
+// Task debug states
+const byte DEBUG_RUN=0;
+const byte DEBUG_SUSPENDED=1;
+const byte DEBUG_STEP=2;    // run one step then suspend
 
 // One instance of RMFT clas is used for each "thread" in the automation.
 // Each thread manages a loco on a journey through the layout, and/or may manage a scenery automation.
@@ -82,7 +99,19 @@ RMFT2 * RMFT2::loopTask=NULL; // loopTask contains the address of ONE of the tas
 RMFT2 * RMFT2::pausingTask=NULL; // Task causing a PAUSE.
  // when pausingTask is set, that is the ONLY task that gets any service,
  // and all others will have their locos stopped, then resumed after the pausing task resumes.
+RMFT2 * RMFT2::waitingTasks=NULL; // Tasks parked by WAITEVENT, not in the ring.
+unsigned long RMFT2::lastWaitCheck=0;
+int16_t RMFT2::breakpoints[MAX_BREAKPOINTS];
+#ifdef EXRAIL_LOADABLE
+const byte * RMFT2::routeCode=RMFT2::RouteCode;
+byte * RMFT2::loadImage=NULL;
+uint16_t RMFT2::loadSize=0;
+uint16_t RMFT2::loadCrc=0;
+uint16_t RMFT2::loadCount=0;
+bool RMFT2::swapPending=false;
+#endif
 byte RMFT2::flags[MAX_FLAGS];
+int16_t RMFT2::registers[MAX_REGISTERS];
 
 LookList *  RMFT2::sequenceLookup=NULL;
 LookList *  RMFT2::onThrowLookup=NULL;
@@ -95,7 +124,12 @@ LookList *  RMFT2::onGreenLookup=NULL;
 LookList *  RMFT2::onChangeLookup=NULL;
 LookList *  RMFT2::onClockLookup=NULL;
 
-#define GET_OPCODE GETHIGHFLASH(RMFT2::RouteCode,progCounter)
+#ifdef EXRAIL_LOADABLE
+#define GET_CODE(pc) (RMFT2::routeCode[pc])
+#else
+#define GET_CODE(pc) GETHIGHFLASH(RMFT2::RouteCode,pc)
+#endif
+#define GET_OPCODE GET_CODE(progCounter)
 #define SKIPOP progCounter+=3
 
 // getOperand instance version, uses progCounter from instance.
@@ -106,8 +140,8 @@ uint16_t RMFT2::getOperand(byte n) {
 // getOperand static version, must be provided prog counter from loop etc.
 uint16_t RMFT2::getOperand(int progCounter,byte n) {
   int offset=progCounter+1+(n*3);
-  byte lsb=GETHIGHFLASH(RouteCode,offset);
-  byte msb=GETHIGHFLASH(RouteCode,offset+1);
+  byte lsb=GET_CODE(offset);
+  byte msb=GET_CODE(offset+1);
   return msb<<8|lsb;
 }
 
@@ -120,6 +154,13 @@ LookList::LookList(int16_t size) {
   }
 }
 
+LookList::~LookList() {
+  if (m_size) {
+    delete[] m_lookupArray;
+    delete[] m_resultArray;
+  }
+}
+
 void LookList::add(int16_t lookup, int16_t result) {
   if (m_loaded==m_size) return; // and forget
   m_lookupArray[m_loaded]=lookup;
@@ -155,15 +196,249 @@ LookList* RMFT2::LookListLoader(OPCODE op1, OPCODE op2, OPCODE op3) {
   return list;
 }
 
+// Check the script for mistakes that the macros can't detect, so that they
+// are reported at startup instead of when (or if) the code is reached.
+// With showSizes, the size of each sequence in bytes is shown too.
+/* static */ void RMFT2::validate(bool showSizes) {
+  int errors=0;
+  int16_t nest=0;
+  int sequenceStart=-1;
+  int16_t sequenceId=0;
+  int progCounter;
+  for (progCounter=0;; SKIPOP) {
+    byte opcode=GET_OPCODE;
+    int16_t operand=getOperand(progCounter,0);
+    LookList * lookup=NULL;
+    const FSH * name=NULL;
+    switch (opcode) {
+      case OPCODE_ROUTE: case OPCODE_AUTOMATION: case OPCODE_SEQUENCE:
+        lookup=sequenceLookup; name=F("SEQUENCE"); break;
+      case OPCODE_ONTHROW: lookup=onThrowLookup; name=F("ONTHROW"); break;
+      case OPCODE_ONCLOSE: lookup=onCloseLookup; name=F("ONCLOSE"); break;
+      case OPCODE_ONACTIVATE: lookup=onActivateLookup; name=F("ONACTIVATE"); break;
+      case OPCODE_ONDEACTIVATE: lookup=onDeactivateLookup; name=F("ONDEACTIVATE"); break;
+      case OPCODE_ONRED: lookup=onRedLookup; name=F("ONRED"); break;
+      case OPCODE_ONAMBER: lookup=onAmberLookup; name=F("ONAMBER"); break;
+      case OPCODE_ONGREEN: lookup=onGreenLookup; name=F("ONGREEN"); break;
+      case OPCODE_ONCHANGE: lookup=onChangeLookup; name=F("ONCHANGE"); break;
+      case OPCODE_ONTIME: lookup=onClockLookup; name=F("ONTIME"); break;
+      default: break;
+    }
+    
+    if (lookup || opcode==OPCODE_ENDEXRAIL) {
+      // End of the previous sequence
+      if (showSizes && sequenceStart>=0)
+        DIAG(F("EXRAIL %d at pc=%d: %d bytes"),sequenceId,sequenceStart,progCounter-sequenceStart);
+      if (nest>0) {
+        DIAG(F("EXRAIL missing ENDIF before pc=%d"),progCounter);
+        errors++;
+      }
+      nest=0;
+      sequenceStart=progCounter;
+      sequenceId=operand;
+    }
+    if (opcode==OPCODE_ENDEXRAIL) break;
+
+    if (lookup && lookup->find(operand)!=progCounter) {
+      DIAG(F("EXRAIL duplicate %S(%d) at pc=%d"),name,operand,progCounter);
+      errors++;
+    }
+    
+    if (opcode>IF_TYPE_OPCODES) nest++;
+    switch (opcode) {
+      case OPCODE_ELSE:
+      case OPCODE_ENDIF:
+        if (nest==0) {
+          DIAG(F("EXRAIL %S without IF at pc=%d"),
+               opcode==OPCODE_ELSE ? F("ELSE") : F("ENDIF"),progCounter);
+          errors++;
+        }
+        else if (opcode==OPCODE_ENDIF) nest--;
+        break;
+        
+      case OPCODE_CALL:
+      case OPCODE_FOLLOW:
+      case OPCODE_START:
+      case OPCODE_SENDLOCO: {
+        int16_t target= (opcode==OPCODE_SENDLOCO) ? getOperand(progCounter,1) : operand;
+        if (sequenceLookup->find(target)<0) {
+          DIAG(F("EXRAIL pc=%d refers to undefined sequence %d"),progCounter,target);
+          errors++;
+        }
+        break;
+      }
+      
+      case OPCODE_RESERVE:
+      case OPCODE_IFRESERVE: {
+        // look for a FREE of the same block anywhere in the script
+        bool freed=false;
+        for (int pc=0;;pc+=3) {
+          byte op=GET_CODE(pc);
+          if (op==OPCODE_ENDEXRAIL) break;
+          if (op==OPCODE_FREE && (int16_t)getOperand(pc,0)==operand) {
+            freed=true;
+            break;
+          }
+        }
+        if (!freed) DIAG(F("EXRAIL block %d reserved at pc=%d is never FREEd"),operand,progCounter);
+        break;
+      }
+      
+      default:
+        break;
+    }
+  }
+  if (errors) DIAG(F("EXRAIL %d errors found"),errors);
+}
+
+#ifdef EXRAIL_LOADABLE
+// A script image is loaded by
+//   </ IMAGE size crc version>  to start, 
+//   </ LOAD offset byte...>     repeated with up to 8 bytes at a time,
+//   </ SWAP>                    to check the image and replace the running script.
+// The crc is CRC-16/CCITT (0x1021, initial 0xFFFF) of the whole image.  The
+// image is only held in RAM, so the compiled script returns at restart.
+// Text (PRINT etc), signal definitions and descriptions are still those 
+// of the compiled script.
+// Turnouts, and the route and automation lists sent to throttles, are 
+// created from the compiled script at startup, so an image that defines
+// them differently is refused; that needs a rebuild and restart.  A swap
+// keeps the flags, registers, signal states and turnouts as they are.
+bool RMFT2::parseLoad(Print * stream, byte paramCount, int16_t p[]) {
+  switch (p[0]) {
+    case HASH_KEYWORD_IMAGE:
+      if (paramCount!=4 || p[1]<=0 || (uint16_t)p[1]>EXRAIL_MAX_IMAGE) return false;
+      if ((uint16_t)p[3]!=EXRAIL_IMAGE_VERSION) {
+        DIAG(F("EXRAIL image version %d, expected %d"),p[3],EXRAIL_IMAGE_VERSION);
+        return false;
+      }
+      if (loadImage) free(loadImage);
+      loadImage=(byte *)malloc(p[1]);
+      if (!loadImage) return false;
+      loadSize=p[1];
+      loadCrc=p[2];
+      loadCount=0;
+      return true;
+      
+    case HASH_KEYWORD_LOAD:
+      // bytes must be sent in order
+      if (!loadImage || paramCount<3 || p[1]!=(int16_t)loadCount
+          || loadCount+paramCount-2 > loadSize) return false;
+      for (byte i=2;i<paramCount;i++) {
+        if (p[i]<0 || p[i]>255) return false;
+        loadImage[loadCount++]=p[i];
+      }
+      return true;
+      
+    case HASH_KEYWORD_SWAP: {
+      if (paramCount!=1 || !loadImage || loadCount!=loadSize) return false;
+      uint16_t crc=0xFFFF;
+      for (uint16_t i=0;i<loadSize;i++) {
+        crc^=(uint16_t)loadImage[i]<<8;
+        for (byte b=0;b<8;b++) crc= (crc & 0x8000) ? (crc<<1)^0x1021 : crc<<1;
+      }
+      if (crc!=loadCrc) {
+        DIAG(F("EXRAIL image CRC error"));
+        return false;
+      }
+      if (loadSize%3!=0 || loadImage[loadSize-3]!=OPCODE_ENDEXRAIL) {
+        DIAG(F("EXRAIL image has no end"));
+        return false;
+      }
+      if (!sameDefinitions(loadImage)) {
+        DIAG(F("EXRAIL image changes turnouts, routes or automations"));
+        return false;
+      }
+      swapPending=true;
+      StringFormatter::send(stream,F("<* EXRAIL image %d bytes accepted *>\n"),loadSize);
+      return true;
+    }
+    
+    default:
+      return false;
+  }
+}
+
+// Kill the tasks of the old script, then start again with the new image
+void RMFT2::swapImage() {
+  swapPending=false;
+  while (waitingTasks) waitingTasks->kill(F("SWAP"));
+  while (loopTask) loopTask->kill(F("SWAP"));
+  pausingTask=NULL;
+  delete sequenceLookup;
+  delete onThrowLookup;
+  delete onCloseLookup;
+  delete onActivateLookup;
+  delete onDeactivateLookup;
+  delete onRedLookup;
+  delete onAmberLookup;
+  delete onGreenLookup;
+  delete onChangeLookup;
+  delete onClockLookup;
+  if (routeCode!=RouteCode) free((void *)routeCode);
+  routeCode=loadImage;
+  loadImage=NULL;
+  loadScript(false);
+}
+
+// Index of the next opcode from pc that defines something held outside
+// EXRAIL: a turnout, or a route or automation listed to throttles by 
+// routeIdList and automationIdList.  Stops at the end of the script.
+static int nextDefinition(const byte * code, int pc) {
+  for (;;pc+=3) {
+    switch (code[pc]) {
+      case OPCODE_TURNOUT:
+      case OPCODE_SERVOTURNOUT:
+      case OPCODE_PINTURNOUT:
+      case OPCODE_ROUTE:
+      case OPCODE_AUTOMATION:
+      case OPCODE_ENDEXRAIL:
+        return pc;
+      default:
+        break;
+    }
+  }
+}
+
+// True if the image defines the same turnouts, routes and automations, in
+// the same order and with the same operands, as the running script.
+bool RMFT2::sameDefinitions(const byte * image) {
+  int pc1=0;
+  int pc2=0;
+  for (;;) {
+    pc1=nextDefinition(routeCode,pc1);
+    pc2=nextDefinition(image,pc2);
+    if (routeCode[pc1]!=image[pc2]) return false;
+    if (image[pc2]==OPCODE_ENDEXRAIL) return true;
+    // compare the opcode and its operands, including those in OPCODE_PADs
+    do {
+      if (memcmp(routeCode+pc1,image+pc2,3)!=0) return false;
+      pc1+=3;
+      pc2+=3;
+    } while (routeCode[pc1]==OPCODE_PAD || image[pc2]==OPCODE_PAD);
+  }
+}
+#endif
+
 /* static */ void RMFT2::begin() {
 
   DIAG(F("EXRAIL RoutCode at =%P"),RouteCode);
     
-  bool saved_diag=diag;
-  diag=true;
   DCCEXParser::setRMFTFilter(RMFT2::ComandFilter);
   for (int f=0;f<MAX_FLAGS;f++) flags[f]=0;
-  
+  for (int r=0;r<MAX_REGISTERS;r++) registers[r]=0;
+  for (byte b=0;b<MAX_BREAKPOINTS;b++) breakpoints[b]=0;
+  loadScript(true);
+}
+
+// Build the lookups from the script, configure its inputs and start its
+// AUTOSTART tasks.  At startup the signals are also set red and the
+// turnouts defined; a swapped image keeps those, along with the flags and
+// registers, as it is only accepted if it defines the same turnouts.
+/* static */ void RMFT2::loadScript(bool startup) {
+  bool saved_diag=diag;
+  diag=true;
+
   // create lookups
   sequenceLookup=LookListLoader(OPCODE_ROUTE, OPCODE_AUTOMATION,OPCODE_SEQUENCE);
   onThrowLookup=LookListLoader(OPCODE_ONTHROW);
@@ -175,11 +450,12 @@ LookList* RMFT2::LookListLoader(OPCODE op1, OPCODE op2, OPCODE op3) {
   onGreenLookup=LookListLoader(OPCODE_ONGREEN);
   onChangeLookup=LookListLoader(OPCODE_ONCHANGE);
   onClockLookup=LookListLoader(OPCODE_ONTIME);
+  validate(false);
 
 
   // Second pass startup, define any turnouts or servos, set signals red
   // add sequences onRoutines to the lookups
-  for (int sigslot=0;;sigslot++) {
+  for (int sigslot=0;startup;sigslot++) {
     VPIN sigid=GETHIGHFLASHW(RMFT2::SignalDefinitions,sigslot*8);
     if (sigid==0) break;  // end of signal list
     doSignal(sigid & SIGNAL_ID_MASK, SIGNAL_RED);
@@ -215,6 +491,7 @@ LookList* RMFT2::LookListLoader(OPCODE op1, OPCODE op2, OPCODE op3) {
     }
 
     case OPCODE_TURNOUT: {
+      if (!startup) break;
       VPIN id=operand;
       int addr=getOperand(progCounter,1);
       byte subAddr=getOperand(progCounter,2);
@@ -223,6 +500,7 @@ LookList* RMFT2::LookListLoader(OPCODE op1, OPCODE op2, OPCODE op3) {
     }
 
     case OPCODE_SERVOTURNOUT: {
+      if (!startup) break;
       VPIN id=operand;
       VPIN pin=getOperand(progCounter,1);
       int activeAngle=getOperand(progCounter,2);
@@ -233,6 +511,7 @@ LookList* RMFT2::LookListLoader(OPCODE op1, OPCODE op2, OPCODE op3) {
     }
 
     case OPCODE_PINTURNOUT: {
+      if (!startup) break;
       VPIN id=operand;
       VPIN pin=getOperand(progCounter,1);
       setTurnoutHiddenState(VpinTurnout::create(id,pin));
@@ -313,15 +592,20 @@ bool RMFT2::parseSlash(Print * stream, byte & paramCount, int16_t p[]) {
     StringFormatter::send(stream, F("<* EXRAIL STATUS"));
     RMFT2 * task=loopTask;
     while(task) {
-      StringFormatter::send(stream,F("\nID=%d,PC=%d,LOCO=%d%c,SPEED=%d%c"),
+      StringFormatter::send(stream,F("\nID=%d,PC=%d,LOCO=%d%c,SPEED=%d%c%S"),
 			    (int)(task->taskId),task->progCounter,task->loco,
 			    task->invert?'I':' ',
 			    task->speedo,
-			    task->forward?'F':'R'
+			    task->forward?'F':'R',
+			    task->debugState==DEBUG_RUN ? F("") : F(",SUSPENDED")
 			    );
       task=task->next;
       if (task==loopTask) break;
     }
+    for (task=waitingTasks; task; task=task->next) {
+      StringFormatter::send(stream,F("\nID=%d,PC=%d,LOCO=%d,WAITEVENT=%d"),
+			    (int)(task->taskId),task->progCounter,task->loco,task->waitEvent);
+    }
     // Now stream the flags
     for (int id=0;id<MAX_FLAGS; id++) {
       byte flag=flags[id];
@@ -331,6 +615,10 @@ bool RMFT2::parseSlash(Print * stream, byte & paramCount, int16_t p[]) {
 	      if (flag & LATCH_FLAG) StringFormatter::send(stream,F(" LATCHED"));
       }
     }
+    // Now stream the registers in use
+    for (int id=0;id<MAX_REGISTERS; id++) {
+      if (registers[id]) StringFormatter::send(stream,F("\nreg[%d]=%d"),id,registers[id]);
+    }
     // do the signals
     // flags[n] represents the state of the nth signal in the table 
     for (int sigslot=0;;sigslot++) {
@@ -353,7 +641,7 @@ bool RMFT2::parseSlash(Print * stream, byte & paramCount, int16_t p[]) {
     return true;
     
   case HASH_KEYWORD_RESUME: // </ RESUME>
-    if (paramCount!=1) return false;
+    if (paramCount!=1) break;  // </ RESUME id> below
     pausingTask=NULL;
     {
       RMFT2 * task=loopTask;
@@ -362,6 +650,8 @@ bool RMFT2::parseSlash(Print * stream, byte & paramCount, int16_t p[]) {
 	task=task->next;
 	if (task==loopTask) break;
       }
+      for (task=waitingTasks; task; task=task->next)
+	if (task->loco) task->driveLoco(task->speedo);
     }
     return true;
     
@@ -378,13 +668,49 @@ bool RMFT2::parseSlash(Print * stream, byte & paramCount, int16_t p[]) {
     }
     return true;
     
+  case HASH_KEYWORD_VALIDATE: // </ VALIDATE> recheck script and show sizes
+    if (paramCount!=1) return false;
+    validate(true);
+    return true;
+    
+#ifdef EXRAIL_LOADABLE
+  case HASH_KEYWORD_IMAGE: // </ IMAGE size crc version>
+  case HASH_KEYWORD_LOAD:  // </ LOAD offset byte...>
+  case HASH_KEYWORD_SWAP:  // </ SWAP>
+    return parseLoad(stream,paramCount,p);
+#endif
+    
+  case HASH_KEYWORD_BREAK: // </ BREAK [pc]> or </ BREAK OP opcode>
+    if (paramCount==1) { // list breakpoints
+      StringFormatter::send(stream,F("<* EXRAIL BREAK"));
+      for (byte i=0;i<MAX_BREAKPOINTS;i++) {
+        int16_t b=breakpoints[i];
+        if (b>0) StringFormatter::send(stream,F(" PC=%d"),b);
+        else if (b<0) StringFormatter::send(stream,F(" OP=%d"),-1-b);
+      }
+      StringFormatter::send(stream,F(" *>\n"));
+      return true;
+    }
+    if (paramCount==3 && p[1]==HASH_KEYWORD_OP && p[2]>=0 && p[2]<256) 
+      return toggleBreakpoint(-1-p[2]);
+    if (paramCount==2 && p[1]>0) return toggleBreakpoint(p[1]);
+    return false;
+    
   default:
     break;
   }
 
+  if (p[0]==HASH_KEYWORD_REG) { // </ REG id [value]>
+    if (paramCount==3) return setRegister(p[1],p[2]);
+    if (paramCount!=2 || p[1]<0 || p[1]>=MAX_REGISTERS) return false;
+    StringFormatter::send(stream,F("<* reg[%d]=%d *>\n"),p[1],registers[p[1]]);
+    return true;
+  }
+
   // check KILL ALL here, otherwise the next validation confuses ALL with a flag  
   if (p[0]==HASH_KEYWORD_KILL && p[1]==HASH_KEYWORD_ALL) {
     while (loopTask) loopTask->kill(F("KILL ALL")); // destructor changes loopTask
+    while (waitingTasks) waitingTasks->kill(F("KILL ALL"));
     return true;   
   }
 
@@ -395,17 +721,32 @@ bool RMFT2::parseSlash(Print * stream, byte & paramCount, int16_t p[]) {
   case HASH_KEYWORD_KILL: // Kill taskid|ALL
     {
     if ( p[1]<0  || p[1]>=MAX_FLAGS) return false;
-    RMFT2 * task=loopTask;
-      while(task) {
-	      if (task->taskId==p[1]) {
-	        task->kill(F("KILL"));
-	        return  true;
-	      }
-	      task=task->next;
-	      if (task==loopTask) break;
-      }
+    RMFT2 * task=findTask(p[1]);
+    if (!task) return false;
+    task->kill(F("KILL"));
+    return true;
+    }
+
+  case HASH_KEYWORD_POST: // </ POST event>
+    postEvent(p[1]);
+    return true;
+
+  case HASH_KEYWORD_SUSPEND: // </ SUSPEND id>
+  case HASH_KEYWORD_RESUME: // </ RESUME id>
+  case HASH_KEYWORD_STEP: // </ STEP id>
+  case HASH_KEYWORD_DUMP: // </ DUMP id>
+    {
+    RMFT2 * task=findTask(p[1]);
+    if (!task) return false;
+    if (p[0]==HASH_KEYWORD_SUSPEND) task->debugState=DEBUG_SUSPENDED;
+    else if (p[0]==HASH_KEYWORD_RESUME) task->debugState=DEBUG_RUN;
+    else if (p[0]==HASH_KEYWORD_STEP) {
+      if (task->debugState==DEBUG_RUN) return false; // must be suspended first
+      task->debugState=DEBUG_STEP;
+    }
+    else task->dump(stream);
+    return true;
     }
-    return false;
     
   case HASH_KEYWORD_RESERVE:  // force reserve a section
     return setFlag(p[1],SECTION_FLAG);
@@ -462,10 +803,32 @@ RMFT2::RMFT2(int progCtr) {
   forward=true;
   invert=false;
   timeoutFlag=false;
+  waiting=false;
+  waitEvent=0;
+  waitTimeout=0;
+  debugState=DEBUG_RUN;
+  breakPc=-1;
   stackDepth=0;
   onEventStartPosition=-1; // Not handling an ONxxx 
+  chainTask();
+}
+
+
+RMFT2::~RMFT2() {
+  driveLoco(1); // ESTOP my loco if any
+  setFlag(taskId,0,TASK_FLAG); // we are no longer using this id
+  if (waiting) {
+    for (RMFT2 ** link=&waitingTasks; *link; link=&(*link)->next)
+      if (*link==this) {
+        *link=next;
+        break;
+      }
+  }
+  else unchainTask();
+}
 
-  // chain into ring of RMFTs
+// chain into ring of RMFTs
+void RMFT2::chainTask() {
   if (loopTask==NULL) {
     loopTask=this;
     next=this;
@@ -475,21 +838,120 @@ RMFT2::RMFT2(int progCtr) {
   }
 }
 
-
-RMFT2::~RMFT2() {
-  driveLoco(1); // ESTOP my loco if any
-  setFlag(taskId,0,TASK_FLAG); // we are no longer using this id
+// remove from ring of RMFTs
+void RMFT2::unchainTask() {
   if (next==this)
     loopTask=NULL;
   else
     for (RMFT2* ring=next;;ring=ring->next)
       if (ring->next == this) {
 	ring->next=next;
-	loopTask=next;
+	loopTask=ring;
 	break;
       }
 }
 
+RMFT2 * RMFT2::findTask(byte id) {
+  RMFT2 * task=loopTask;
+  while(task) {
+    if (task->taskId==id) return task;
+    task=task->next;
+    if (task==loopTask) break;
+  }
+  for (task=waitingTasks; task; task=task->next)
+    if (task->taskId==id) return task;
+  return NULL;
+}
+
+// Set the breakpoint if not already set, otherwise clear it.
+bool RMFT2::toggleBreakpoint(int16_t breakpoint) {
+  int16_t * freeSlot=NULL;
+  for (byte i=0;i<MAX_BREAKPOINTS;i++) {
+    if (breakpoints[i]==breakpoint) {
+      breakpoints[i]=0;
+      return true;
+    }
+    if (breakpoints[i]==0 && !freeSlot) freeSlot=&breakpoints[i];
+  }
+  if (!freeSlot) return false;
+  *freeSlot=breakpoint;
+  return true;
+}
+
+bool RMFT2::isBreakpoint(int pc, byte opcode) {
+  for (byte i=0;i<MAX_BREAKPOINTS;i++) {
+    int16_t b=breakpoints[i];
+    if (b==0) continue;
+    if (b>0 ? b==pc : -1-b==opcode) return true;
+  }
+  return false;
+}
+
+void RMFT2::dump(Print * stream) {
+  StringFormatter::send(stream,F("<* EXRAIL TASK %d PC=%d OP=%d OPERAND=%d %S"),
+    taskId,progCounter,GET_OPCODE,(int16_t)getOperand(0),
+    debugState==DEBUG_RUN ? F("RUNNING") : F("SUSPENDED"));
+  StringFormatter::send(stream,F("\nLOCO=%d SPEED=%d %c%S TIMEOUT=%d"),
+    loco,speedo,forward?'F':'R',invert?F(" INVERT"):F(""),timeoutFlag);
+  if (delayTime!=0 && millis()-delayStart < delayTime)
+    StringFormatter::send(stream,F("\nDELAY=%lms"),delayTime-(millis()-delayStart));
+  if (waiting) StringFormatter::send(stream,F("\nWAITEVENT=%d"),waitEvent);
+  if (onEventStartPosition>=0) StringFormatter::send(stream,F("\nEVENT PC=%d"),onEventStartPosition);
+  StringFormatter::send(stream,F("\nSTACK=%d"),stackDepth);
+  for (byte i=0;i<stackDepth;i++) StringFormatter::send(stream,F(" %d"),callStack[i]);
+  StringFormatter::send(stream,F(" *>\n"));
+}
+
+// WAITEVENT takes the task out of the ring, so a waiting task costs nothing
+// in loop() until the event is posted or its timeout expires.
+void RMFT2::waitForEvent(int16_t event, uint16_t timeout) {
+  unchainTask();
+  waiting=true;
+  waitEvent=event;
+  waitTimeout=timeout;
+  timeoutStart=millis();
+  timeoutFlag=false;
+  next=waitingTasks;
+  waitingTasks=this;
+}
+
+// Put a waiting task back in the ring.  The caller has unlinked it from waitingTasks.
+void RMFT2::endWait(bool timedOut) {
+  waiting=false;
+  timeoutFlag=timedOut;
+  chainTask();
+}
+
+// Wake all tasks waiting for this event.  An event posted when no task is 
+// waiting for it is not remembered.
+void RMFT2::postEvent(int16_t event) {
+  if (diag) DIAG(F("EXRAIL POST %d"),event);
+  RMFT2 ** link=&waitingTasks;
+  while (*link) {
+    RMFT2 * task=*link;
+    if (task->waitEvent==event) {
+      *link=task->next;
+      task->endWait(false);
+    }
+    else link=&task->next;
+  }
+}
+
+void RMFT2::checkWaitTimeouts() {
+  unsigned long now=millis();
+  if (now-lastWaitCheck < 50) return;
+  lastWaitCheck=now;
+  RMFT2 ** link=&waitingTasks;
+  while (*link) {
+    RMFT2 * task=*link;
+    if (task->waitTimeout && now-task->timeoutStart >= 100UL*task->waitTimeout) {
+      *link=task->next;
+      task->endWait(true);
+    }
+    else link=&task->next;
+  }
+}
+
 void RMFT2::createNewTask(int route, uint16_t cab) {
       int pc=sequenceLookup->find(route);
       if (pc<0) return;
@@ -570,6 +1032,12 @@ bool RMFT2::skipIfBlock() {
 
 void RMFT2::loop() {
 
+#ifdef EXRAIL_LOADABLE
+  // Swap here, as </ SWAP> may have come from a running task 
+  if (swapPending) swapImage();
+#endif
+  if (waitingTasks) checkWaitTimeouts();
+  
   // Round Robin call to a RMFT task each time
   if (loopTask==NULL) return;
   loopTask=loopTask->next;
@@ -578,11 +1046,27 @@ void RMFT2::loop() {
 
 
 void RMFT2::loop2() {
+  if (debugState==DEBUG_SUSPENDED) return;
   if (delayTime!=0 && millis()-delayStart < delayTime) return;
 
   byte opcode = GET_OPCODE;
   int16_t operand =  getOperand(0);
 
+  if (debugState==DEBUG_STEP) {
+    // execute this step only
+    debugState=DEBUG_SUSPENDED;
+    breakPc=progCounter;
+  }
+  else if (progCounter!=breakPc) {
+    breakPc=-1;
+    if (isBreakpoint(progCounter,opcode)) {
+      DIAG(F("EXRAIL task %d break at pc=%d op=%d"),taskId,progCounter,opcode);
+      debugState=DEBUG_SUSPENDED;
+      breakPc=progCounter;
+      return;
+    }
+  }
+
   // skipIf will get set to indicate a failing IF condition 
   bool skipIf=false; 
 
@@ -622,6 +1106,15 @@ void RMFT2::loop2() {
     } 
     break;
 
+  case OPCODE_SPEEDREG:
+    forward=DCC::getThrottleDirection(loco)^invert;
+    driveLoco(constrain(getRegister(operand),0,127));
+    break;
+    
+  case OPCODE_SPEEDSTEPS:
+    if (loco) DCC::setSpeedSteps(loco,operand);
+    break;
+
   case OPCODE_INVERT_DIRECTION:
     invert= !invert;
     driveLoco(speedo);
@@ -708,7 +1201,14 @@ void RMFT2::loop2() {
     break;
 
   case OPCODE_POM:
-    if (loco) DCC::writeCVByteMain(loco, operand, getOperand(1));
+    if (loco) {
+      // wait for room in the queue so that a long list of POMs isn't sent blocking 
+      if (DCC::isPOMQueueFull()) {
+        delayMe(50);
+        return;
+      }
+      DCC::writeCVByteMain(loco, operand, getOperand(1));
+    }
     break;
 
   case OPCODE_POWEROFF:
@@ -749,6 +1249,22 @@ void RMFT2::loop2() {
     skipIf=IODevice::readAnalogue(operand)>=(int)(getOperand(1));
     break;
     
+  case OPCODE_IFREGEQ: // do block if register == value
+    skipIf=getRegister(operand)!=(int16_t)getOperand(1);
+    break;
+    
+  case OPCODE_IFREGNE: // do block if register != value
+    skipIf=getRegister(operand)==(int16_t)getOperand(1);
+    break;
+    
+  case OPCODE_IFREGGT: // do block if register > value
+    skipIf=getRegister(operand)<=(int16_t)getOperand(1);
+    break;
+    
+  case OPCODE_IFREGLT: // do block if register < value
+    skipIf=getRegister(operand)>=(int16_t)getOperand(1);
+    break;
+    
   case OPCODE_IFLOCO: // do if the loco is the active one
     skipIf=loco!=(uint16_t)operand; // bad luck if someone enters negative loco numbers into EXRAIL
     break;
@@ -801,6 +1317,18 @@ void RMFT2::loop2() {
     delayMe(operand*100L);
     break;
     
+  case OPCODE_DELAYREG: // delay for register value in seconds
+    delayMe(getRegister(operand)>0 ? getRegister(operand)*1000L : 0);
+    break;
+    
+  case OPCODE_REGSET:
+    setRegister(operand,getOperand(1));
+    break;
+    
+  case OPCODE_REGADD:
+    setRegister(operand,getRegister(operand)+(int16_t)getOperand(1));
+    break;
+    
   case OPCODE_DELAYMINS:
     delayMe(operand*60L*1000L);
     break;
@@ -882,9 +1410,18 @@ void RMFT2::loop2() {
     return;
 
   case OPCODE_KILLALL:
+    while(waitingTasks) waitingTasks->kill(F("KILLALL"));
     while(loopTask) loopTask->kill(F("KILLALL"));
     return;
 
+  case OPCODE_POST:
+    postEvent(operand);
+    break;
+    
+  case OPCODE_WAITEVENT: // park until POST(operand), IFTIMEOUT is true if timed out
+    waitForEvent(operand,getOperand(1));
+    break;
+
 #ifndef DISABLE_PROG
   case OPCODE_JOIN:
     TrackManager::setPower(POWERMODE::ON);
@@ -1018,6 +1555,17 @@ bool RMFT2::getFlag(VPIN id,byte mask) {
   return flags[id]&mask;
 }
 
+int16_t RMFT2::getRegister(int16_t id) {
+  if (id<0 || id>=MAX_REGISTERS) return 0;
+  return registers[id];
+}
+
+bool RMFT2::setRegister(int16_t id, int16_t value) {
+  if (id<0 || id>=MAX_REGISTERS) return false;
+  registers[id]=value;
+  return true;
+}
+
 void RMFT2::kill(const FSH * reason, int operand) {
   if (reason) DIAG(F("EXRAIL ERROR pc=%d, cab=%d, %S %d"), progCounter,loco, reason, operand);
   else if (diag) DIAG(F("ENDTASK at pc=%d"), progCounter);
@@ -1155,6 +1703,12 @@ void RMFT2::handleEvent(const FSH* reason,LookList* handlers, int16_t id) {
     task=task->next;
     if (task==loopTask) break;
   }
+  for (task=waitingTasks; task; task=task->next) {
+    if (task->onEventStartPosition==pc) {
+      DIAG(F("Recursive ON%S(%d)"),reason, id);
+      return;
+    }
+  }
   
   task=new RMFT2(pc);  // new task starts at this instruction
   task->onEventStartPosition=pc; // flag for recursion detector
@@ -1172,39 +1726,39 @@ void RMFT2::thrungeString(uint32_t strfar, thrunger mode, byte id) {
    // Find out where the string is going 
    switch (mode) {
     case thrunge_print:
-         StringFormatter::send(&USB_SERIAL,F("<* EXRAIL(%d) "),loco);
-         stream=&USB_SERIAL;
+         StringFormatter::send(SerialManager::output(&USB_SERIAL),F("<* EXRAIL(%d) "),loco);
+         stream=SerialManager::output(&USB_SERIAL);
          break;
 
-    case thrunge_serial: stream=&USB_SERIAL; break;  
+    case thrunge_serial: stream=SerialManager::output(&USB_SERIAL); break;  
     case thrunge_serial1: 
          #ifdef SERIAL1_COMMANDS
-         stream=&Serial1; 
+         stream=SerialManager::output(&Serial1);
          #endif
          break;
     case thrunge_serial2: 
          #ifdef SERIAL2_COMMANDS
-         stream=&Serial2; 
+         stream=SerialManager::output(&Serial2);
          #endif
          break;
     case thrunge_serial3: 
          #ifdef SERIAL3_COMMANDS
-         stream=&Serial3; 
+         stream=SerialManager::output(&Serial3);
          #endif
          break;
     case thrunge_serial4: 
          #ifdef SERIAL4_COMMANDS
-         stream=&Serial4; 
+         stream=SerialManager::output(&Serial4);
          #endif
          break;
     case thrunge_serial5: 
          #ifdef SERIAL5_COMMANDS
-         stream=&Serial5; 
+         stream=SerialManager::output(&Serial5);
          #endif
          break;
    case thrunge_serial6: 
          #ifdef SERIAL6_COMMANDS
-         stream=&Serial6; 
+         stream=SerialManager::output(&Serial6);
          #endif
          break;
     case thrunge_lcn: 
@@ -1239,11 +1793,11 @@ void RMFT2::thrungeString(uint32_t strfar, thrunger mode, byte id) {
   // and decide what to do next
    switch (mode) {
     case thrunge_print:
-         StringFormatter::send(&USB_SERIAL,F(" *>\n"));
+         StringFormatter::send(SerialManager::output(&USB_SERIAL),F(" *>\n"));
          break;
     // TODO  more serials for SAMx case thrunge_serial4: stream=&Serial4; break;
     case thrunge_parse: 
-      DCCEXParser::parseOne(&USB_SERIAL,(byte*)buffer->getString(),NULL);
+      DCCEXParser::parseOne(SerialManager::output(&USB_SERIAL),(byte*)buffer->getString(),NULL);
       break;
     case thrunge_broadcast:
       CommandDistributor::broadcastRaw(CommandDistributor::COMMAND_TYPE,buffer->getString());
@@ -49,7 +49,7 @@ enum OPCODE : byte {OPCODE_THROW,OPCODE_CLOSE,
              OPCODE_JOIN,OPCODE_UNJOIN,OPCODE_READ_LOCO1,OPCODE_READ_LOCO2,
 #endif
              OPCODE_POM,
-             OPCODE_START,OPCODE_SETLOCO,OPCODE_SENDLOCO,OPCODE_FORGET,
+             OPCODE_START,OPCODE_SETLOCO,OPCODE_SENDLOCO,OPCODE_FORGET,OPCODE_SPEEDSTEPS,
              OPCODE_PAUSE, OPCODE_RESUME,OPCODE_POWEROFF,OPCODE_POWERON,
              OPCODE_ONCLOSE, OPCODE_ONTHROW, OPCODE_SERVOTURNOUT, OPCODE_PINTURNOUT,
              OPCODE_PRINT,OPCODE_DCCACTIVATE,
@@ -62,6 +62,8 @@ enum OPCODE : byte {OPCODE_THROW,OPCODE_CLOSE,
              OPCODE_ONCHANGE,
              OPCODE_ONCLOCKTIME,
              OPCODE_ONTIME,
+             OPCODE_REGSET,OPCODE_REGADD,OPCODE_DELAYREG,OPCODE_SPEEDREG,
+             OPCODE_POST,OPCODE_WAITEVENT,
 
              // OPcodes below this point are skip-nesting IF operations
              // placed here so that they may be skipped as a group
@@ -74,7 +76,8 @@ enum OPCODE : byte {OPCODE_THROW,OPCODE_CLOSE,
              OPCODE_IFRANDOM,OPCODE_IFRESERVE,
              OPCODE_IFCLOSED,OPCODE_IFTHROWN,
              OPCODE_IFRE,
-             OPCODE_IFLOCO
+             OPCODE_IFLOCO,
+             OPCODE_IFREGEQ,OPCODE_IFREGNE,OPCODE_IFREGGT,OPCODE_IFREGLT
              };
 
 // Ensure thrunge_lcd is put last as there may be more than one display, 
@@ -101,13 +104,31 @@ enum thrunger: byte {
   static const byte SIGNAL_GREEN = 0x04;
 
   static const byte  MAX_STACK_DEPTH=4;
+  static const byte  MAX_BREAKPOINTS=4;
  
    static const short MAX_FLAGS=256;
+
+#ifndef ARDUINO_ARCH_AVR
+  // On flat memory processors a new script image can be loaded into RAM 
+  // and replace the compiled one without a restart, see </ IMAGE>. 
+  // The version is changed when the opcodes change.
+  #define EXRAIL_LOADABLE
+  static const uint16_t EXRAIL_IMAGE_VERSION=1;
+  static const uint16_t EXRAIL_MAX_IMAGE=16384;
+#endif
   #define FLAGOVERFLOW(x) x>=MAX_FLAGS
 
+  // Integer registers for counting, dwell times etc.
+#if defined(HAS_ENOUGH_MEMORY)
+   static const short MAX_REGISTERS=64;
+#else
+   static const short MAX_REGISTERS=16;
+#endif
+
 class LookList {
   public: 
     LookList(int16_t size);
+    ~LookList();
     void add(int16_t lookup, int16_t result);
     int16_t find(int16_t value);
   private:
@@ -130,6 +151,7 @@ class LookList {
     static void activateEvent(int16_t addr, bool active);
     static void changeEvent(int16_t id, bool change);
     static void clockEvent(int16_t clocktime, bool change);
+    static void postEvent(int16_t event);
     static const int16_t SERVO_SIGNAL_FLAG=0x4000;
     static const int16_t ACTIVE_HIGH_SIGNAL_FLAG=0x2000;
     static const int16_t DCC_SIGNAL_FLAG=0x1000;
@@ -151,6 +173,8 @@ private:
     static void streamFlags(Print* stream);
     static bool setFlag(VPIN id,byte onMask, byte OffMask=0);
     static bool getFlag(VPIN id,byte mask); 
+    static int16_t getRegister(int16_t id);
+    static bool setRegister(int16_t id, int16_t value);
     static int16_t progtrackLocoId;
     static void doSignal(int16_t id,char rag); 
     static bool isSignal(int16_t id,char rag); 
@@ -159,9 +183,23 @@ private:
     static LookList* LookListLoader(OPCODE op1,
                       OPCODE op2=OPCODE_ENDEXRAIL,OPCODE op3=OPCODE_ENDEXRAIL);
     static void handleEvent(const FSH* reason,LookList* handlers, int16_t id);
+    static void validate(bool showSizes);
+    static void loadScript(bool startup);
     static uint16_t getOperand(int progCounter,byte n);
     static RMFT2 * loopTask;
     static RMFT2 * pausingTask;
+    static RMFT2 * waitingTasks;
+    static unsigned long lastWaitCheck;
+    static void checkWaitTimeouts();
+    static RMFT2 * findTask(byte taskId);
+    static bool toggleBreakpoint(int16_t breakpoint);
+    static bool isBreakpoint(int pc, byte opcode);
+    static int16_t breakpoints[MAX_BREAKPOINTS];  // pc, or -1-opcode. 0 if unused
+    void dump(Print * stream);
+    void chainTask();
+    void unchainTask();
+    void waitForEvent(int16_t event, uint16_t timeout);
+    void endWait(bool timedOut);
     void delayMe(long millisecs);
     void driveLoco(byte speedo);
     bool readSensor(uint16_t sensorId);
@@ -176,8 +214,20 @@ private:
     
    static bool diag;
    static const  HIGHFLASH  byte RouteCode[];
+#ifdef EXRAIL_LOADABLE
+   static const byte * routeCode;  // RouteCode or a loaded image
+   static byte * loadImage;        // image being loaded
+   static uint16_t loadSize;
+   static uint16_t loadCrc;
+   static uint16_t loadCount;
+   static bool swapPending;
+   static bool parseLoad(Print * stream, byte paramCount, int16_t p[]);
+   static void swapImage();
+   static bool sameDefinitions(const byte * image);
+#endif
    static const  HIGHFLASH  int16_t SignalDefinitions[];
    static byte flags[MAX_FLAGS];
+   static int16_t registers[MAX_REGISTERS];
    static LookList * sequenceLookup;
    static LookList * onThrowLookup;
    static LookList * onCloseLookup;
@@ -196,10 +246,15 @@ private:
     unsigned long  delayTime;
     union {
       unsigned long waitAfter; // Used by OPCODE_AFTER
-      unsigned long timeoutStart; // Used by OPCODE_ATTIMEOUT
+      unsigned long timeoutStart; // Used by OPCODE_ATTIMEOUT and OPCODE_WAITEVENT
     };
     bool timeoutFlag;
     byte  taskId;
+    bool waiting;       // parked in waitingTasks by WAITEVENT
+    int16_t waitEvent;
+    uint16_t waitTimeout; // in 100ms units, 0 = wait forever
+    byte debugState;    // DEBUG_xxx
+    int breakPc;        // pc of last breakpoint, so it isn't hit again on resume
     
     uint16_t loco;
     bool forward;
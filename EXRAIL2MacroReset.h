@@ -26,6 +26,7 @@
 // Undefine all RMFT macros
 #undef ACTIVATE
 #undef ACTIVATEL
+#undef ADDREG
 #undef AFTER
 #undef ALIAS
 #undef AMBER
@@ -40,11 +41,13 @@
 #undef CALL 
 #undef CLOSE 
 #undef DCC_SIGNAL
+#undef DECREG
 #undef DEACTIVATE
 #undef DEACTIVATEL
 #undef DELAY
 #undef DELAYMINS
 #undef DELAYRANDOM 
+#undef DELAYREG
 #undef DONE
 #undef DRIVE
 #undef ELSE
@@ -76,6 +79,11 @@
 #undef IFTHROWN
 #undef IFTIMEOUT
 #undef IFRE
+#undef IFREGEQ
+#undef IFREGGT
+#undef IFREGLT
+#undef IFREGNE
+#undef INCREG
 #undef INVERT_DIRECTION 
 #undef JOIN 
 #undef KILLALL
@@ -104,6 +112,7 @@
 #ifndef DISABLE_PROG
 #undef POM
 #endif
+#undef POST
 #undef POWEROFF
 #undef POWERON
 #undef READ_LOCO 
@@ -131,11 +140,15 @@
 #undef SET
 #undef SET_TRACK
 #undef SETLOCO 
+#undef SETREG
 #undef SIGNAL 
 #undef SIGNALH 
 #undef SPEED 
+#undef SPEEDREG
+#undef SPEEDSTEPS
 #undef START 
 #undef STOP 
+#undef SUBREG
 #undef THROW  
 #undef TURNOUT 
 #undef TURNOUTL
@@ -143,6 +156,8 @@
 #undef UNLATCH 
 #undef VIRTUAL_SIGNAL
 #undef VIRTUAL_TURNOUT
+#undef WAITEVENT
+#undef WAITEVENTTIMEOUT
 #undef WAITFOR
 #undef WITHROTTLE
 #undef XFOFF
@@ -151,6 +166,7 @@
 #ifndef RMFT2_UNDEF_ONLY
 #define ACTIVATE(addr,subaddr)
 #define ACTIVATEL(addr)
+#define ADDREG(reg,value)
 #define AFTER(sensor_id)
 #define ALIAS(name,value...)
 #define AMBER(signal_id)
@@ -165,11 +181,13 @@
 #define CALL(route) 
 #define CLOSE(id) 
 #define DCC_SIGNAL(id,add,subaddr)
+#define DECREG(reg)
 #define DEACTIVATE(addr,subaddr)
 #define DEACTIVATEL(addr)
 #define DELAY(mindelay)
 #define DELAYMINS(mindelay)
 #define DELAYRANDOM(mindelay,maxdelay) 
+#define DELAYREG(reg)
 #define DONE
 #define DRIVE(analogpin)
 #define ELSE
@@ -201,6 +219,11 @@
 #define IFRESERVE(block)
 #define IFTIMEOUT
 #define IFRE(sensor_id,value)
+#define IFREGEQ(reg,value)
+#define IFREGGT(reg,value)
+#define IFREGLT(reg,value)
+#define IFREGNE(reg,value)
+#define INCREG(reg)
 #define INVERT_DIRECTION 
 #define JOIN 
 #define KILLALL
@@ -229,6 +252,7 @@
 #ifndef DISABLE_PROG
 #define POM(cv,value)
 #endif
+#define POST(event)
 #define POWEROFF
 #define POWERON
 #define READ_LOCO 
@@ -256,11 +280,15 @@
 #define SET(pin) 
 #define SET_TRACK(track,mode)
 #define SETLOCO(loco) 
+#define SETREG(reg,value)
 #define SIGNAL(redpin,amberpin,greenpin) 
 #define SIGNALH(redpin,amberpin,greenpin) 
 #define SPEED(speed) 
+#define SPEEDREG(reg)
+#define SPEEDSTEPS(steps) 
 #define START(route) 
 #define STOP 
+#define SUBREG(reg,value)
 #define THROW(id)  
 #define TURNOUT(id,addr,subaddr,description...) 
 #define TURNOUTL(id,addr,description...) 
@@ -268,6 +296,8 @@
 #define UNLATCH(sensor_id) 
 #define VIRTUAL_SIGNAL(id) 
 #define VIRTUAL_TURNOUT(id,description...) 
+#define WAITEVENT(event)
+#define WAITEVENTTIMEOUT(event,timeout)
 #define WAITFOR(pin)
 #define WITHROTTLE(msg)
 #define XFOFF(cab,func)
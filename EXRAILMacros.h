@@ -257,6 +257,7 @@ const  HIGHFLASH  int16_t RMFT2::SignalDefinitions[] = {
 
 #define ACTIVATE(addr,subaddr) OPCODE_DCCACTIVATE,V(addr<<3 | subaddr<<1 | 1),
 #define ACTIVATEL(addr) OPCODE_DCCACTIVATE,V((addr+3)<<1 | 1),
+#define ADDREG(reg,value) OPCODE_REGADD,V(reg),OPCODE_PAD,V(value),
 #define AFTER(sensor_id) OPCODE_AT,V(sensor_id),OPCODE_AFTER,V(sensor_id),
 #define ALIAS(name,value...) 
 #define AMBER(signal_id) OPCODE_AMBER,V(signal_id),
@@ -275,7 +276,9 @@ const  HIGHFLASH  int16_t RMFT2::SignalDefinitions[] = {
 #define DELAY(ms) ms<30000?OPCODE_DELAYMS:OPCODE_DELAY,V(ms/(ms<30000?1L:100L)),
 #define DELAYMINS(mindelay) OPCODE_DELAYMINS,V(mindelay),
 #define DELAYRANDOM(mindelay,maxdelay) DELAY(mindelay) OPCODE_RANDWAIT,V((maxdelay-mindelay)/100L),
+#define DELAYREG(reg) OPCODE_DELAYREG,V(reg),
 #define DCC_SIGNAL(id,add,subaddr)
+#define DECREG(reg) OPCODE_REGADD,V(reg),OPCODE_PAD,V(-1),
 #define DONE OPCODE_ENDTASK,0,0,
 #define DRIVE(analogpin) OPCODE_DRIVE,V(analogpin),
 #define ELSE OPCODE_ELSE,0,0,
@@ -307,6 +310,11 @@ const  HIGHFLASH  int16_t RMFT2::SignalDefinitions[] = {
 #define IFTHROWN(turnout_id) OPCODE_IFTHROWN,V(turnout_id),
 #define IFTIMEOUT OPCODE_IFTIMEOUT,0,0,
 #define IFRE(sensor_id,value) OPCODE_IFRE,V(sensor_id),OPCODE_PAD,V(value),
+#define IFREGEQ(reg,value) OPCODE_IFREGEQ,V(reg),OPCODE_PAD,V(value),
+#define IFREGGT(reg,value) OPCODE_IFREGGT,V(reg),OPCODE_PAD,V(value),
+#define IFREGLT(reg,value) OPCODE_IFREGLT,V(reg),OPCODE_PAD,V(value),
+#define IFREGNE(reg,value) OPCODE_IFREGNE,V(reg),OPCODE_PAD,V(value),
+#define INCREG(reg) OPCODE_REGADD,V(reg),OPCODE_PAD,V(1),
 #define INVERT_DIRECTION OPCODE_INVERT_DIRECTION,0,0,
 #define JOIN OPCODE_JOIN,0,0,
 #define KILLALL OPCODE_KILLALL,0,0,
@@ -333,6 +341,7 @@ const  HIGHFLASH  int16_t RMFT2::SignalDefinitions[] = {
 #ifndef DISABLE_PROG
 #define POM(cv,value) OPCODE_POM,V(cv),OPCODE_PAD,V(value),
 #endif
+#define POST(event) OPCODE_POST,V(event),
 #define POWEROFF OPCODE_POWEROFF,0,0,
 #define POWERON OPCODE_POWERON,0,0,
 #define PRINT(msg) OPCODE_PRINT,V(__COUNTER__ - StringMacroTracker2),
@@ -362,11 +371,15 @@ const  HIGHFLASH  int16_t RMFT2::SignalDefinitions[] = {
 #define SET(pin) OPCODE_SET,V(pin),
 #define SET_TRACK(track,mode)  OPCODE_SET_TRACK,V(TRACK_MODE_##mode  <<8 | TRACK_NUMBER_##track),
 #define SETLOCO(loco) OPCODE_SETLOCO,V(loco),
+#define SETREG(reg,value) OPCODE_REGSET,V(reg),OPCODE_PAD,V(value),
 #define SIGNAL(redpin,amberpin,greenpin) 
 #define SIGNALH(redpin,amberpin,greenpin) 
 #define SPEED(speed) OPCODE_SPEED,V(speed),
+#define SPEEDSTEPS(steps) OPCODE_SPEEDSTEPS,V(steps),
+#define SPEEDREG(reg) OPCODE_SPEEDREG,V(reg),
 #define START(route) OPCODE_START,V(route),
 #define STOP OPCODE_SPEED,V(0), 
+#define SUBREG(reg,value) OPCODE_REGADD,V(reg),OPCODE_PAD,V(-(value)),
 #define THROW(id)  OPCODE_THROW,V(id),
 #define TURNOUT(id,addr,subaddr,description...) OPCODE_TURNOUT,V(id),OPCODE_PAD,V(addr),OPCODE_PAD,V(subaddr),
 #define TURNOUTL(id,addr,description...) TURNOUT(id,(addr-1)/4+1,(addr-1)%4, description)
@@ -374,6 +387,8 @@ const  HIGHFLASH  int16_t RMFT2::SignalDefinitions[] = {
 #define UNLATCH(sensor_id) OPCODE_UNLATCH,V(sensor_id),
 #define VIRTUAL_SIGNAL(id) 
 #define VIRTUAL_TURNOUT(id,description...) OPCODE_PINTURNOUT,V(id),OPCODE_PAD,V(0), 
+#define WAITEVENT(event) OPCODE_WAITEVENT,V(event),OPCODE_PAD,V(0),
+#define WAITEVENTTIMEOUT(event,timeout) OPCODE_WAITEVENT,V(event),OPCODE_PAD,V((timeout+99)/100L),
 #define WITHROTTLE(msg) PRINT(msg)
 #define WAITFOR(pin) OPCODE_WAITFOR,V(pin),
 #define XFOFF(cab,func) OPCODE_XFOFF,V(cab),OPCODE_PAD,V(func),
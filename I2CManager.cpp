@@ -151,6 +151,22 @@ void I2CManagerClass::begin(void) {
       } 
     }
 #endif
+
+#if defined(I2C_MULTIPLE_BUSES)
+    // Enumerate devices on the other buses (if mapped in config.h).  Devices
+    // behind multiplexers on these buses aren't searched for.
+    for (uint8_t bus=I2CBus_1; bus<=I2CBus_2; bus++) {
+      _setBusClock((I2CBus)bus, 100000);
+      for (uint8_t addr=0x08; addr<0x78; addr++) {
+        if (exists({(I2CBus)bus, addr})) {
+          found = true; 
+          DIAG(F("I2C Device found at {I2CBus_%d,0x%x}, %S?"), 
+            bus, addr, guessI2CDeviceType(addr));
+        }
+      }
+      _setBusClock((I2CBus)bus, _busClockSpeed[bus-1]);
+    }
+#endif
     if (!found) DIAG(F("No I2C Devices found"));
     _setClock(_clockSpeed);
     setTimeout(originalTimeout);      // set timeout back to original
@@ -167,6 +183,26 @@ void I2CManagerClass::setClock(uint32_t speed) {
   _setClock(_clockSpeed);
 }
 
+// Set clock speed of the address's bus to the lowest one requested for 
+//  that bus.  Without multiple buses, this is the same as setClock(speed).
+void I2CManagerClass::setClock(I2CAddress address, uint32_t speed) {
+#if defined(I2C_MULTIPLE_BUSES)
+  I2CBus bus = address.busNumber();
+  if (bus != I2CBus_0) {
+    if (bus > I2CBus_2) return;
+    if (speed < _busClockSpeed[bus-1] && !_clockSpeedFixed) {
+      _busClockSpeed[bus-1] = speed;
+      DIAG(F("I2C bus %d clock speed set to %l Hz"), bus, speed);
+    }
+    _setBusClock(bus, _busClockSpeed[bus-1]);
+    return;
+  }
+#else
+  (void)address;  // suppress compiler warning
+#endif
+  setClock(speed);
+}
+
 // Force clock speed to that specified.
 void I2CManagerClass::forceClock(uint32_t speed) {
   _clockSpeed = speed;
@@ -278,7 +314,7 @@ const FSH *I2CManagerClass::getErrorMessage(uint8_t status) {
 I2CManagerClass I2CManager = I2CManagerClass();
 
 // Buffer for conversion of I2CAddress to char*.
-/* static */ char I2CAddress::addressBuffer[30];
+/* static */ char I2CAddress::addressBuffer[40];
 
 /////////////////////////////////////////////////////////////////////////////
 // Helper functions associated with I2C Request Block
@@ -139,11 +139,24 @@
 // I2C multiplexer support.
 /////////////////////////////////////////////////////////////////////////////////////
 
-// Currently only one bus supported, and one instance of I2CManager to handle it.
+// Bus 0 is the main I2C bus.  Further buses are only available when the
+// Wire library is in use, and each is mapped onto a TwoWire instance in
+// config.h, e.g.
+//   #define I2C_BUS1_WIRE Wire1
+//   #define I2C_BUS2_WIRE Wire2
+// Each bus has its own clock speed, so a slow device on one bus doesn't
+// hold back the devices on the others.  The native (non-Wire) drivers
+// only drive bus 0, and fail any request addressed to another bus.
 enum I2CBus : uint8_t {
     I2CBus_0 = 0,
+    I2CBus_1 = 1,
+    I2CBus_2 = 2,
 };
 
+#if defined(I2C_EXTENDED_ADDRESS) && defined(I2C_USE_WIRE)
+#define I2C_MULTIPLE_BUSES
+#endif
+
 // Currently I2CAddress supports one I2C bus, with up to eight
 // multipexers (MUX) attached.  Each MUX can have up to eight sub-buses.
 enum I2CMux : uint8_t {
@@ -235,7 +248,7 @@ public:
   // For I2CAddress in form "{i2cAddress, deviceAddress}"
   // where deviceAddress is to be on the same subbus as i2cAddress.
   I2CAddress(I2CAddress firstAddress, uint8_t newDeviceAddress) :
-    I2CAddress(firstAddress._muxNumber, firstAddress._subBus, newDeviceAddress) {}
+    I2CAddress(firstAddress._busNumber, firstAddress._muxNumber, firstAddress._subBus, newDeviceAddress) {}
 
   // Conversion operator from I2CAddress to uint8_t
   // For "uint8_t address = i2cAddress;" syntax
@@ -247,6 +260,12 @@ public:
   // single DIAG statement for example.
   const char* toString() { 
     char *ptr = addressBuffer;
+    if (_busNumber != I2CBus_0) {
+      strcpy_P(ptr, (const char*)F("{I2CBus_"));
+      ptr += 8;
+      *ptr++ = '0' + _busNumber;
+      *ptr++ = ',';
+    }
     if (_muxNumber != I2CMux_None) {
       strcpy_P(ptr, (const char*)F("{I2CMux_"));
       ptr += 8;
@@ -267,6 +286,8 @@ public:
     ptr += 4;
     if (_muxNumber != I2CMux_None)
       *ptr++ = '}';
+    if (_busNumber != I2CBus_0)
+      *ptr++ = '}';
     *ptr = 0; // terminate string
     return addressBuffer;
   }
@@ -275,6 +296,8 @@ public:
   int operator == (I2CAddress &a) const {
     if (_deviceAddress != a._deviceAddress) 
       return false; // Different device address so no match
+    if (_busNumber != a._busNumber)
+      return false; // Different I2C bus
     if (_muxNumber == I2CMux_None || a._muxNumber == I2CMux_None)
       return true;  // Same device address, one or other on main bus
     if (_subBus == SubBus_None || a._subBus == SubBus_None) 
@@ -286,6 +309,7 @@ public:
     return true;  // Same address on same mux and same subbus
   }
   // Field accessors
+  I2CBus busNumber() { return _busNumber; }
   I2CMux muxNumber() { return _muxNumber; }
   I2CSubBus subBus() { return _subBus; }
   uint8_t deviceAddress() { return _deviceAddress; }
@@ -428,6 +452,9 @@ public:
   void begin(void);
   // Set clock speed to the lowest requested one.
   void setClock(uint32_t speed);
+  // Set clock speed of the bus that the address is on to the lowest 
+  // requested for that bus.
+  void setClock(I2CAddress address, uint32_t speed);
   // Force clock speed 
   void forceClock(uint32_t speed);
   // setTimeout sets the timout value for I2C transactions (milliseconds).
@@ -478,6 +505,11 @@ private:
   // and STM32 but most popular I2C devices are 400kHz so in practice the higher speeds
   // will not be useful.  The speed can be overridden by I2CManager::forceClock().
   uint32_t _clockSpeed = I2C_FREQ;  
+#if defined(I2C_MULTIPLE_BUSES)
+  // Clock speeds for I2CBus_1 and I2CBus_2.
+  uint32_t _busClockSpeed[2] = {I2C_FREQ, I2C_FREQ};
+  void _setBusClock(I2CBus bus, unsigned long speed);
+#endif
   // Default timeout 100ms on I2C request block completion.
   // A full 32-byte transmission takes about 8ms at 100kHz,
   // so this value allows lots of headroom.  
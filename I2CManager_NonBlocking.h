@@ -172,6 +172,15 @@ void I2CManagerClass::startTransaction() {
  *  Function to queue a request block and initiate operations.
  ***************************************************************************/
 void I2CManagerClass::queueRequest(I2CRB *req) {
+#if defined(I2C_EXTENDED_ADDRESS)
+  // The native drivers only operate the main I2C bus; other buses 
+  // need the Wire library (I2C_USE_WIRE).
+  if (req->i2cAddress.busNumber() != I2CBus_0) {
+    req->nBytes = 0;
+    req->status = I2C_STATUS_UNEXPECTED_ERROR;
+    return;
+  }
+#endif
   req->status = I2C_STATUS_PENDING;
   req->nextRequest = NULL;
   ATOMIC_BLOCK() {
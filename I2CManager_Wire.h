@@ -35,6 +35,28 @@
 #define WIRE_HAS_TIMEOUT
 #endif
 
+/***************************************************************************
+ *  Get the Wire instance for the bus that the address is on.  Returns
+ *   NULL if the bus hasn't been mapped to a TwoWire instance in config.h.
+ ***************************************************************************/
+static TwoWire *wireFor(I2CAddress address) {
+#if defined(I2C_MULTIPLE_BUSES)
+  switch (address.busNumber()) {
+    case I2CBus_0: return &Wire;
+#if defined(I2C_BUS1_WIRE)
+    case I2CBus_1: return &I2C_BUS1_WIRE;
+#endif
+#if defined(I2C_BUS2_WIRE)
+    case I2CBus_2: return &I2C_BUS2_WIRE;
+#endif
+    default: return NULL;
+  }
+#else
+  (void)address;  // suppress compiler warning
+  return &Wire;
+#endif
+}
+
 /***************************************************************************
  *  Initialise I2C interface software
  ***************************************************************************/
@@ -43,6 +65,14 @@ void I2CManagerClass::_initialise() {
 #if defined(WIRE_HAS_TIMEOUT) 
   Wire.setWireTimeout(_timeout, true);
 #endif
+#if defined(I2C_MULTIPLE_BUSES)
+#if defined(I2C_BUS1_WIRE)
+  I2C_BUS1_WIRE.begin();
+#endif
+#if defined(I2C_BUS2_WIRE)
+  I2C_BUS2_WIRE.begin();
+#endif
+#endif
 }
 
 /***************************************************************************
@@ -53,6 +83,13 @@ void I2CManagerClass::_setClock(unsigned long i2cClockSpeed) {
   Wire.setClock(i2cClockSpeed);
 }
 
+#if defined(I2C_MULTIPLE_BUSES)
+void I2CManagerClass::_setBusClock(I2CBus bus, unsigned long i2cClockSpeed) {
+  TwoWire *wire = wireFor(I2CAddress(bus, 0));
+  if (wire) wire->setClock(i2cClockSpeed);
+}
+#endif
+
 /***************************************************************************
  *  Set I2C timeout value in microseconds.  The timeout applies to each
  *   Wire call separately, i.e. in a write+read, the timer is reset before the
@@ -69,12 +106,12 @@ void I2CManagerClass::setTimeout(unsigned long value) {
  * Helper function for I2C Multiplexer operations
  ********************************************************/
 #ifdef I2C_EXTENDED_ADDRESS
-static uint8_t muxSelect(I2CAddress address) {
+static uint8_t muxSelect(TwoWire *wire, I2CAddress address) {
   // Select MUX sub bus.
   I2CMux muxNo = address.muxNumber();
   I2CSubBus subBus = address.subBus();
   if (muxNo != I2CMux_None) {
-    Wire.beginTransmission(I2C_MUX_BASE_ADDRESS+muxNo); 
+    wire->beginTransmission(I2C_MUX_BASE_ADDRESS+muxNo); 
     uint8_t data =  (subBus == SubBus_All) ? 0xff :
                     (subBus == SubBus_None) ? 0x00 :
 #if defined(I2CMUX_PCA9547)
@@ -86,8 +123,8 @@ static uint8_t muxSelect(I2CAddress address) {
                     // with a bit set for the subBus to be enabled
                     1 << subBus;
 #endif
-    Wire.write(&data, 1);
-    return Wire.endTransmission(true);  // have to release I2C bus for it to work
+    wire->write(&data, 1);
+    return wire->endTransmission(true);  // have to release I2C bus for it to work
   }
   return I2C_STATUS_OK;
 }
@@ -99,6 +136,13 @@ static uint8_t muxSelect(I2CAddress address) {
  ***************************************************************************/
 uint8_t I2CManagerClass::write(I2CAddress address, const uint8_t buffer[], uint8_t size, I2CRB *rb) {
   uint8_t status, muxStatus;
+  TwoWire *wire = wireFor(address);
+  if (!wire) {
+    // Bus not configured
+    rb->nBytes = 0;
+    rb->status = I2C_STATUS_UNEXPECTED_ERROR;
+    return I2C_STATUS_OK;
+  }
   uint8_t retryCount = 0;
   // If request fails, retry up to the defined limit, unless the NORETRY flag is set
   // in the request block.
@@ -106,19 +150,19 @@ uint8_t I2CManagerClass::write(I2CAddress address, const uint8_t buffer[], uint8
     status = muxStatus = I2C_STATUS_OK;
 #ifdef I2C_EXTENDED_ADDRESS
     if (address.muxNumber() != I2CMux_None)
-      muxStatus = muxSelect(address);
+      muxStatus = muxSelect(wire, address);
 #endif
     // Only send new transaction if address is non-zero.
     if (muxStatus == I2C_STATUS_OK && address != 0) {
-      Wire.beginTransmission(address);
-      if (size > 0) Wire.write(buffer, size);
-      status = Wire.endTransmission();
+      wire->beginTransmission(address);
+      if (size > 0) wire->write(buffer, size);
+      status = wire->endTransmission();
     }
 #ifdef I2C_EXTENDED_ADDRESS
     // Deselect MUX if there's more than one MUX present, to avoid having multiple ones selected
     if (_muxCount > 1 && muxStatus == I2C_STATUS_OK 
           && address.deviceAddress() != 0 && address.muxNumber() != I2CMux_None) {
-      muxSelect({address.muxNumber(), SubBus_None});
+      muxSelect(wire, {address.busNumber(), address.muxNumber(), SubBus_None, 0});
     }
     if (muxStatus != I2C_STATUS_OK) status = muxStatus;
 #endif
@@ -147,6 +191,13 @@ uint8_t I2CManagerClass::read(I2CAddress address, uint8_t readBuffer[], uint8_t
                               const uint8_t writeBuffer[], uint8_t writeSize, I2CRB *rb)
 {
   uint8_t status, muxStatus;
+  TwoWire *wire = wireFor(address);
+  if (!wire) {
+    // Bus not configured
+    rb->nBytes = 0;
+    rb->status = I2C_STATUS_UNEXPECTED_ERROR;
+    return I2C_STATUS_OK;
+  }
   uint8_t nBytes = 0;
   uint8_t retryCount = 0;
   // If request fails, retry up to the defined limit, unless the NORETRY flag is set
@@ -155,31 +206,31 @@ uint8_t I2CManagerClass::read(I2CAddress address, uint8_t readBuffer[], uint8_t
     status = muxStatus = I2C_STATUS_OK;
 #ifdef I2C_EXTENDED_ADDRESS
     if (address.muxNumber() != I2CMux_None) {
-      muxStatus = muxSelect(address);
+      muxStatus = muxSelect(wire, address);
     }
 #endif
     // Only start new transaction if address is non-zero.
     if (muxStatus == I2C_STATUS_OK && address != 0) {
       if (writeSize > 0) {
-        Wire.beginTransmission(address);
-        Wire.write(writeBuffer, writeSize);
-        status = Wire.endTransmission(false); // Don't free bus yet
+        wire->beginTransmission(address);
+        wire->write(writeBuffer, writeSize);
+        status = wire->endTransmission(false); // Don't free bus yet
       }
       if (status == I2C_STATUS_OK) {
 #ifdef WIRE_HAS_TIMEOUT
-        Wire.clearWireTimeoutFlag();
-        Wire.requestFrom(address, (size_t)readSize);
-        if (!Wire.getWireTimeoutFlag()) {
-          while (Wire.available() && nBytes < readSize) 
-            readBuffer[nBytes++] = Wire.read();
+        wire->clearWireTimeoutFlag();
+        wire->requestFrom(address, (size_t)readSize);
+        if (!wire->getWireTimeoutFlag()) {
+          while (wire->available() && nBytes < readSize) 
+            readBuffer[nBytes++] = wire->read();
           if (nBytes < readSize) status = I2C_STATUS_TRUNCATED;
         } else {
           status = I2C_STATUS_TIMEOUT;
         }
 #else
-        Wire.requestFrom(address, (size_t)readSize);
-          while (Wire.available() && nBytes < readSize) 
-            readBuffer[nBytes++] = Wire.read();
+        wire->requestFrom(address, (size_t)readSize);
+          while (wire->available() && nBytes < readSize) 
+            readBuffer[nBytes++] = wire->read();
           if (nBytes < readSize) status = I2C_STATUS_TRUNCATED;
 #endif
       }
@@ -187,7 +238,7 @@ uint8_t I2CManagerClass::read(I2CAddress address, uint8_t readBuffer[], uint8_t
 #ifdef I2C_EXTENDED_ADDRESS
     // Deselect MUX if there's more than one MUX present, to avoid having multiple ones selected
     if (_muxCount > 1 && muxStatus == I2C_STATUS_OK && address != 0 && address.muxNumber() != I2CMux_None) {
-      muxSelect({address.muxNumber(), SubBus_None});
+      muxSelect(wire, {address.busNumber(), address.muxNumber(), SubBus_None, 0});
     }
     if (muxStatus != I2C_STATUS_OK) status = muxStatus;
 #endif
@@ -25,6 +25,7 @@
 #include "DIAG.h" 
 #include "FSH.h"
 #include "IO_MCP23017.h"
+#include "IO_HCSR04.h"
 #include "DCCTimer.h"
 
 #if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_MEGAAVR)
@@ -373,6 +374,9 @@ IODevice *IODevice::_firstDevice = 0;
 // Reference to next device to be called on _loop() method.
 IODevice *IODevice::_nextLoopDevice = 0;
 
+// HC-SR04 sensor currently measuring, when they share an echo interrupt.
+HCSR04 * volatile HCSR04::_activeSensor = NULL;
+
 
 //==================================================================================================================
 // Instance members
@@ -59,22 +59,79 @@ typedef uint16_t VPIN;
 class IONotifyCallback {
 public: 
   typedef void IONotifyCallbackFunction(VPIN vpin, int value);
-  static void add(IONotifyCallbackFunction *function) {
-    IONotifyCallback *blk = new IONotifyCallback(function);
-    if (first) blk->next = first;
-    first = blk;
+  // Register a callback for changes on any VPIN, or only on VPINs in the 
+  // range firstVpin to lastVpin.  The range of an existing callback can be
+  // widened later with extend().
+  // The callbacks are kept in order of their first VPIN, so that a search
+  // stops at the first callback whose range starts beyond the changed VPINs.
+  static IONotifyCallback *add(IONotifyCallbackFunction *function, 
+      VPIN firstVpin=0, VPIN lastVpin=VPIN_MAX) {
+    IONotifyCallback *blk = new IONotifyCallback(function, firstVpin, lastVpin);
+    blk->insert();
+    return blk;
   }
+  void extend(VPIN vpin) {
+    if (vpin >= _firstVpin && vpin <= _lastVpin) return;
+    remove();
+    if (vpin < _firstVpin) _firstVpin = vpin;
+    if (vpin > _lastVpin) _lastVpin = vpin;
+    insert();
+  }
+  // Notify a change on a single VPIN to the callbacks whose range includes it.
   static void invokeAll(VPIN vpin, int value) {
-    for (IONotifyCallback *blk = first; blk != NULL; blk = blk->next)
-      blk->invoke(vpin, value);
+    for (IONotifyCallback *blk = first; blk != NULL && blk->_firstVpin <= vpin; blk = blk->next)
+      if (vpin <= blk->_lastVpin)
+        blk->invoke(vpin, value);
+  }
+  // Notify changes on a group of up to 32 VPINs starting at firstVpin, e.g. a
+  // whole GPIO port.  Bit n of 'changes' is set if firstVpin+n has changed,
+  // and bit n of 'states' is then its new value.  Each callback is only called 
+  // for the changed VPINs within its range.
+  static void invokeAll(VPIN firstVpin, uint8_t nPins, uint32_t changes, uint32_t states) {
+    VPIN lastVpin = firstVpin + nPins - 1;
+    for (IONotifyCallback *blk = first; blk != NULL && blk->_firstVpin <= lastVpin; blk = blk->next) {
+      if (blk->_lastVpin < firstVpin) continue;
+      VPIN vpin = max(firstVpin, blk->_firstVpin);
+      VPIN endVpin = min(lastVpin, blk->_lastVpin);
+      for (; vpin <= endVpin; vpin++) {
+        uint32_t mask = 1UL << (vpin - firstVpin);
+        if (changes & mask) blk->invoke(vpin, (states & mask) != 0);
+      }
+    }
   }
   static bool hasCallback() {
     return first != NULL;
   }
+  // Check if any callback is interested in the VPINs firstVpin to lastVpin.
+  static bool hasCallback(VPIN firstVpin, VPIN lastVpin) {
+    for (IONotifyCallback *blk = first; blk != NULL && blk->_firstVpin <= lastVpin; blk = blk->next)
+      if (blk->_lastVpin >= firstVpin) return true;
+    return false;
+  }
 private:
-  IONotifyCallback(IONotifyCallbackFunction *function) { invoke = function; };
+  IONotifyCallback(IONotifyCallbackFunction *function, VPIN firstVpin, VPIN lastVpin) { 
+    invoke = function; 
+    _firstVpin = firstVpin;
+    _lastVpin = lastVpin;
+  };
+  // Link into the list in order of _firstVpin.
+  void insert() {
+    IONotifyCallback **pp = &first;
+    while (*pp != NULL && (*pp)->_firstVpin <= _firstVpin) pp = &(*pp)->next;
+    next = *pp;
+    *pp = this;
+  }
+  void remove() {
+    for (IONotifyCallback **pp = &first; *pp != NULL; pp = &(*pp)->next)
+      if (*pp == this) {
+        *pp = next;
+        return;
+      }
+  }
   IONotifyCallback *next = 0;
   IONotifyCallbackFunction *invoke = 0;
+  VPIN _firstVpin;
+  VPIN _lastVpin;
   static IONotifyCallback *first;
 };
 
@@ -77,7 +77,7 @@ private:
     I2CManager.begin();
     // ADS111x support high-speed I2C (4.3MHz) but that requires special
     // processing.  So stick to fast mode (400kHz maximum).
-    I2CManager.setClock(400000);
+    I2CManager.setClock(_I2CAddress, 400000);
     // Initialise ADS device
     if (I2CManager.exists(_I2CAddress)) {
       _nextState = STATE_STARTSCAN;
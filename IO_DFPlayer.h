@@ -42,10 +42,22 @@
  * SD card; e.g. a value of 1 will play the first file, 2 for the second file etc.
  * Writing an analogue value 0 to the first pin (3500) will stop the file playing;
  * Writing an analogue value 0-30 to the second pin (3501) will set the volume;
+ * Writing an analogue value 1-2999 to the third pin (3502) will play the numbered file repeatedly;
+ * Writing an analogue value 0-5 to the fourth pin (3503) will set the equaliser
+ *   (0=Normal, 1=Pop, 2=Rock, 3=Jazz, 4=Classic, 5=Bass);
+ * Writing an analogue value 1-255 to the fifth pin (3504), with the folder number 1-99 as
+ *   the second parameter, will play that track from the numbered folder (e.g. 01/005.mp3);
  * Writing a digital value of 1 to a pin will play the file corresponding to that pin, e.g.
    the first file will be played by setting pin 3500, the second by setting pin 3501 etc.;
- * Writing a digital value of 0 to any pin will stop the player;
- * Reading a digital value from any pin will return true(1) if the player is playing, false(0) otherwise.
+ * Writing a digital value of 0 to any pin will stop the player and clear the queue;
+ * Reading a digital value from any pin will return true(1) if the player is playing or has
+ *   files queued, false(0) otherwise.
+ *
+ * Play requests are normally acted on immediately, replacing whatever is playing and anything
+ * queued.  If the third parameter of writeAnalogue is non-zero, the request is queued instead
+ * and played when the previous files have finished, so sound cues from EX-RAIL don't cut each
+ * other off.  Up to 6 files may be queued.  Volume and equaliser changes go ahead of queued
+ * files, and a new volume or equaliser setting replaces one that hasn't been sent yet.
  * 
  * From EX-RAIL, the following commands may be used:
  *   SET(3500)      -- starts playing the first file (file 1) on the SD card
@@ -55,6 +67,9 @@
  *   WAITFOR(3500)  -- wait for the file currently being played by the player to complete
  *   SERVO(3500,2,Instant)  -- plays file 2 at current volume
  *   SERVO(3501,20,Instant)   -- Sets the volume to 20
+ *   ANOUT(3500,3,0,1)  -- queues file 3 to play after the current file
+ *   ANOUT(3504,5,2,0)  -- plays track 5 from folder 02
+ *   ANOUT(3502,4,0,0)  -- plays file 4 repeatedly until stopped
  * 
  * NB The DFPlayer's serial lines are not 5V safe, so connecting the Arduino TX directly 
  * to the DFPlayer's RX terminal will cause lots of noise over the speaker, or worse.
@@ -87,7 +102,22 @@ private:
   bool _awaitingResponse = false;
   uint8_t _requestedVolumeLevel = MAXVOLUME;
   uint8_t _currentVolume = MAXVOLUME;
-  int _requestedSong = -1;  // -1=none, 0=stop, >0=file number
+  int8_t _requestedEQ = -1;  // -1=none, 0-5=equaliser setting
+  bool _stopRequested = false;
+  // Queue of play commands waiting to be sent.  The one at the head is sent when the
+  // player is idle, or straight away if it was requested to play immediately.
+  struct PlayCommand {
+    uint8_t command;
+    uint16_t arg;
+  };
+  static const uint8_t QUEUESIZE = 6;
+  PlayCommand _queue[QUEUESIZE];
+  uint8_t _queueCount = 0;
+  bool _playNow = false;  // head of queue to interrupt current file
+  // Time (us) that the last play command was sent.  For a short time after
+  // it, the status poll may still report the player as stopped.
+  unsigned long _playStartTime = 0;
+  const unsigned long PLAYSTART_GRACE = 1500000UL;
   
 public:
  
@@ -158,8 +188,12 @@ protected:
         case 6:
           switch (_recvCMD) {
             case 0x42:
-              // Response to status query
-              _playing = (c != 0);
+              // Response to status query.  Ignore 'stopped' if a file has
+              // only just been started, as the player may not have begun it yet.
+              if (c != 0)
+                _playing = true;
+              else if ((int32_t)(micros() - _playStartTime) > (int32_t)PLAYSTART_GRACE)
+                _playing = false;
               // Mark the device online and cancel timeout
               if (_deviceState==DEVSTATE_INITIALISING) {
                 _deviceState = DEVSTATE_NORMAL;
@@ -216,13 +250,21 @@ protected:
         // Change volume before changing song if volume is reducing.
         _currentVolume = _requestedVolumeLevel;
         sendPacket(0x06, _currentVolume);
-      } else if (_requestedSong > 0) {
-        // Change song
-        sendPacket(0x03, _requestedSong);
-        _requestedSong = -1;
-      } else if (_requestedSong == 0) {
+      } else if (_requestedEQ >= 0) {
+        // Equaliser changes also go ahead of any queued file.
+        sendPacket(0x07, _requestedEQ);
+        _requestedEQ = -1;
+      } else if (_stopRequested) {
         sendPacket(0x16);  // Stop playing
-        _requestedSong = -1;
+        _stopRequested = false;
+      } else if (_queueCount > 0 && (_playNow || !_playing)) {
+        // Play next file from queue
+        sendPacket(_queue[0].command, _queue[0].arg);
+        for (uint8_t i = 1; i < _queueCount; i++) _queue[i-1] = _queue[i];
+        _queueCount--;
+        _playNow = false;
+        _playing = true;
+        _playStartTime = currentMicros;
       } else if (_currentVolume < _requestedVolumeLevel) {
         // Change volume after changing song if volume is increasing.
         _currentVolume = _requestedVolumeLevel;
@@ -249,15 +291,13 @@ protected:
       #ifdef DIAG_IO
       DIAG(F("DFPlayer: Play %d"), pin+1);
       #endif
-      _requestedSong = pin+1;
-      _playing = true;
+      queuePlay(0x03, pin+1, false);
     } else {
       // Value 0, stop playing
       #ifdef DIAG_IO
       DIAG(F("DFPlayer: Stop"));
       #endif
-      _requestedSong = 0;  // No song
-      _playing = false;
+      stop();
     }
   }
 
@@ -265,39 +305,76 @@ protected:
   // Volume may be specified as second parameter to writeAnalogue.
   // If value is zero, the player stops playing.  
   // WriteAnalogue on second pin sets the output volume.
+  // WriteAnalogue on third pin plays the file repeatedly, on the fourth pin sets the 
+  // equaliser and on the fifth pin plays a track from the folder given as second parameter.
+  // If the third parameter is non-zero, a file is queued to play after those already queued.
   //
-  void _writeAnalogue(VPIN vpin, int value, uint8_t volume=0, uint16_t=0) override { 
+  void _writeAnalogue(VPIN vpin, int value, uint8_t param=0, uint16_t queued=0) override { 
     if (_deviceState == DEVSTATE_FAILED) return;
     uint8_t pin = vpin - _firstVpin;
  
     #ifdef DIAG_IO
-    DIAG(F("DFPlayer: VPIN:%u FileNo:%d Volume:%d"), vpin, value, volume);
+    DIAG(F("DFPlayer: VPIN:%u Value:%d Param:%d Queued:%d"), vpin, value, param, queued);
     #endif
 
-    // Validate parameter.
-    if (volume > MAXVOLUME) volume = MAXVOLUME;
+    switch (pin) {
+      case 0:  // Play file, param is volume
+        if (value > 0) {
+          if (param > MAXVOLUME) param = MAXVOLUME;
+          if (param > 0)
+            _requestedVolumeLevel = param;
+          queuePlay(0x03, value, queued);
+        } else
+          stop();
+        break;
+      case 1:  // Set volume (0-30)
+        if (value > MAXVOLUME) value = MAXVOLUME;
+        if (value >= 0) _requestedVolumeLevel = value;  
+        break;
+      case 2:  // Play file repeatedly
+        if (value > 0)
+          queuePlay(0x08, value, queued);
+        else
+          stop();
+        break;
+      case 3:  // Equaliser (0-5)
+        if (value >= 0 && value <= 5) _requestedEQ = value;
+        break;
+      case 4:  // Play track from folder, param is folder number
+        if (value > 0 && value <= 255 && param > 0 && param <= 99)
+          queuePlay(0x0F, ((uint16_t)param << 8) | value, queued);
+        break;
+    }
+  }
 
-    if (pin == 0) {
-      // Play track 
-      if (value > 0) {
-        if (volume > 0)
-          _requestedVolumeLevel = volume;
-        _requestedSong = value;
-        _playing = true;
-      } else {
-        _requestedSong = 0; // stop playing
-        _playing = false;
-      }
-    } else if (pin == 1) {
-      // Set volume (0-30)
-      _requestedVolumeLevel = value;  
+  // Add a play command to the queue.  Unless it is to be queued after what
+  // is already playing, it replaces the current file and anything queued.
+  void queuePlay(uint8_t command, uint16_t arg, bool queued) {
+    if (!queued) {
+      _queueCount = 0;
+      _playNow = true;
+    } else if (_queueCount >= QUEUESIZE) {
+      DIAG(F("DFPlayer: Queue full"));
+      return;
     }
+    _queue[_queueCount].command = command;
+    _queue[_queueCount].arg = arg;
+    _queueCount++;
+  }
+
+  // Stop playing and discard anything queued.
+  void stop() {
+    _queueCount = 0;
+    _playNow = false;
+    _stopRequested = true;
+    _playing = false;
   }
 
-  // A read on any pin indicates whether the player is still playing.
+  // A read on any pin indicates whether the player is still playing, or has files
+  // queued, so WAITFOR waits until the queue has finished.
   int _read(VPIN) override {
     if (_deviceState == DEVSTATE_FAILED) return false;
-    return _playing;
+    return _playing || _queueCount > 0;
   }
 
   void _display() override {
@@ -88,27 +88,35 @@ void _begin() override {
   }
 }
 
-// Processing loop to obtain clock time
+// Processing loop to obtain clock time.  The read is non-blocking; the
+// request is issued on one entry and the result processed on a later one.
 
 void _loop(unsigned long currentMicros) override{ 
   
   if (FAST_CLOCK_EXISTS==true) {
-      uint8_t readBuffer[3];
-      byte a,b;
       #ifdef EXRAIL_ACTIVE
-        I2CManager.read(_I2CAddress, readBuffer, 3);
-        // XXXX change this to save a few bytes
-        a = readBuffer[0];
-        b = readBuffer[1];
-        //_clocktime = (a << 8) + b;
-        //_clockrate = readBuffer[2];
+        if (_i2crb.isBusy()) return;  // Read still in progress
+        if (!_readPending) {
+          I2CManager.read(_I2CAddress, _readBuffer, 3, NULL, 0, &_i2crb);
+          _readPending = true;
+          return;
+        }
+        _readPending = false;
+        if (_i2crb.status != I2C_STATUS_OK) {
+          delayUntil(currentMicros + 1000000UL);  // try again in a second
+          return;
+        }
+        byte a = _readBuffer[0];
+        byte b = _readBuffer[1];
+        byte rate = _readBuffer[2];
 
-        CommandDistributor::setClockTime(((a << 8) + b), readBuffer[2], 1);
+        CommandDistributor::setClockTime(((a << 8) + b), rate, 1);
         //setClockTime(int16_t clocktime, int8_t clockrate, byte opt);
         
         // As the minimum clock increment is 2 seconds delay a bit - say 1 sec.
-        // Clock interval is 60/ clockspeed i.e 60/b seconds
-        delayUntil(currentMicros + ((60/b) * 1000000));  
+        // Clock interval is 60/ clockspeed i.e 60/rate seconds
+        if (rate == 0) rate = 1;  // clock stopped, check once a minute
+        delayUntil(currentMicros + ((60/rate) * 1000000UL));  
      
       #endif
     
@@ -119,6 +127,10 @@ void _loop(unsigned long currentMicros) override{
   void _display() override {
     DIAG(F("FastCLock on I2C:%s - %S"), _I2CAddress.toString(),  (_deviceState==DEVSTATE_FAILED) ? F("OFFLINE") : F(""));
   }
+
+  I2CRB _i2crb;
+  uint8_t _readBuffer[3];
+  bool _readPending = false;
   
 };
 
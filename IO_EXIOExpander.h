@@ -36,6 +36,18 @@
 * correct purpose, however the EX-IOExpander device's pin map will prevent pins being used
 * incorrectly (eg. A6/7 on Nano cannot be used for digital input/output).
 *
+* Digital and servo/PWM writes are queued and sent from _loop using a non-blocking I2C
+* request, so setting a number of outputs does not hold up the CS while each one is
+* acknowledged.  A write to a pin which already has a write waiting in the queue
+* replaces the waiting one.  The queue holds EXIO_OUTBOUND_QUEUE_SIZE writes to
+* different pins (24 by default, enough for a large route, or 8 on small boards).
+* If it is full, the new write is discarded with a diagnostic message rather
+* than holding up the CS.
+*
+* If the EX-IOExpander supports the delta read command, a single transfer returns a
+* sequence number, the digital input states and only those analogue inputs that have moved
+* by more than a deadband, in place of the separate digital and analogue reads.
+*
 * The total number of pins cannot exceed 256 because of the communications packet format.
 * The number of analogue inputs cannot exceed 16 because of a limit on the maximum
 * I2C packet size of 32 bytes (in the Wire library).
@@ -49,6 +61,14 @@
 #include "DIAG.h"
 #include "FSH.h"
 
+#ifndef EXIO_OUTBOUND_QUEUE_SIZE
+#if defined(HAS_ENOUGH_MEMORY)
+#define EXIO_OUTBOUND_QUEUE_SIZE 24
+#else
+#define EXIO_OUTBOUND_QUEUE_SIZE 8
+#endif
+#endif
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 /*
  * IODevice subclass for EX-IOExpander.
@@ -160,6 +180,7 @@ private:
         }
         DIAG(F("EX-IOExpander device found, I2C:%s, Version v%d.%d.%d"),
             _I2CAddress.toString(), _majorVer, _minorVer, _patchVer);
+        setupDeltaRead();
 
 #ifdef DIAG_IO
         _display();
@@ -224,12 +245,67 @@ private:
     return false;
   }
 
+  // See if the device supports the delta read command, by sending one and checking the
+  // response flag.  Older devices respond with an error and use separate reads.
+  void setupDeltaRead() {
+    _deltaSupported = false;
+    _deltaSynced = false;
+    if (3 + (_numDigitalPins + 7) / 8 > 32) return;  // Digital states won't fit
+    size_t deltaBytesNeeded = 3 + (_numDigitalPins + 7) / 8 + 3 * _numAnaloguePins;
+    if (deltaBytesNeeded > 32) deltaBytesNeeded = 32;  // I2C packet size limit
+    if (_deltaBufferBytes < deltaBytesNeeded) {
+      if (_deltaBufferBytes > 0) free(_deltaBuffer);
+      _deltaBufferBytes = 0;
+      if ((_deltaBuffer = (uint8_t *)calloc(deltaBytesNeeded, 1)) == NULL) return;
+      _deltaBufferBytes = deltaBytesNeeded;
+    }
+    _deltaReadBytes = deltaBytesNeeded;
+    uint8_t commandBuffer[2] = {EXIORDDELTA, _analogueDeadband};
+    if (I2CManager.read(_I2CAddress, _deltaBuffer, _deltaReadBytes, commandBuffer, 2) == I2C_STATUS_OK
+        && _deltaBuffer[0] == EXIORDDELTA) {
+      _deltaSupported = true;
+      // The probe may have consumed changes, so read everything in full first
+      _fullReadPending = FULL_READ_DIGITAL | FULL_READ_ANALOGUE;
+    }
+  }
+
+  // Process the response to a delta read:
+  //  [0] EXIORDDELTA
+  //  [1] sequence number, incremented by the device on each response
+  //  [2] number of analogue values included
+  //  [3...] digital input states, one bit per pin
+  //  then for each changed analogue input: analogue index, LSB, MSB.
+  // A gap in the sequence means a response has been lost, so the analogue values
+  // (which are only sent when they change) are read again in full.
+  void processDeltaRead() {
+    if (_deltaBuffer[0] != EXIORDDELTA) return;
+    uint8_t sequence = _deltaBuffer[1];
+    if (_deltaSynced && sequence != (uint8_t)(_deltaSequence + 1))
+      _fullReadPending |= FULL_READ_ANALOGUE;
+    _deltaSequence = sequence;
+    _deltaSynced = true;
+    uint8_t digitalBytes = (_numDigitalPins + 7) / 8;
+    memcpy(_digitalInputStates, &_deltaBuffer[3], digitalBytes);
+    uint8_t pos = 3 + digitalBytes;
+    for (uint8_t i = 0; i < _deltaBuffer[2] && pos + 2 < _deltaReadBytes; i++, pos += 3) {
+      uint8_t aPin = _deltaBuffer[pos];
+      if (aPin >= _numAnaloguePins) continue;
+      _analogueInputStates[aPin * 2] = _deltaBuffer[pos + 1];
+      _analogueInputStates[aPin * 2 + 1] = _deltaBuffer[pos + 2];
+    }
+  }
+
   // Main loop, collect both digital and analogue pin states continuously (faster sensor/input reads)
   void _loop(unsigned long currentMicros) override {
     if (_deviceState == DEVSTATE_FAILED) return;    // If device failed, return
 
+    // Writes are queued by _write and _writeAnalogue and sent one at a time using
+    // a separate request block, so they go out in between the input reads.
+    processOutbound();
+    if (_deviceState == DEVSTATE_FAILED) return;
+
     // Request block is used for analogue and digital reads from the IOExpander, which are performed
-    // on a cyclic basis.  Writes are performed synchronously as and when requested.
+    // on a cyclic basis.
 
     if (_readState != RDS_IDLE) {
       if (_i2crb.isBusy()) return;                // If I2C operation still in progress, return
@@ -244,21 +320,38 @@ private:
           // do this to avoid tearing of the values (i.e. one byte of a two-byte value being changed
           // while the value is being read).
           memcpy(_analogueInputStates, _analogueInputBuffer, _analoguePinBytes); // Copy I2C input buffer to states
+          _fullReadPending &= ~FULL_READ_ANALOGUE;
 
         } else if (_readState == RDS_DIGITAL) {
           // Read of digital states was in progress, so process received values 
           // The received digital states are placed directly into the digital buffer on receipt, 
           // so don't need any further processing at this point (unless we want to check for
           // changes and notify them to subscribers, to avoid the need for polling - see IO_GPIOBase.h).
+          _fullReadPending &= ~FULL_READ_DIGITAL;
+        } else if (_readState == RDS_DELTA) {
+          processDeltaRead();
         }
-      } else
+      } else {
         reportError(status, false);   // report eror but don't go offline.
+        if (_readState == RDS_DELTA) _fullReadPending |= FULL_READ_ANALOGUE;
+      }
 
       _readState = RDS_IDLE;
     }
 
     // If we're not doing anything now, check to see if a new input transfer is due.
-    if (_readState == RDS_IDLE) {
+    if (_readState == RDS_IDLE && _deltaSupported && !_fullReadPending) {
+      // One delta read replaces both the digital and analogue reads.
+      if (currentMicros - _lastDigitalRead > _digitalRefresh) {
+        _readCommandBuffer[0] = EXIORDDELTA;
+        _readCommandBuffer[1] = _analogueDeadband;
+        I2CManager.read(_I2CAddress, _deltaBuffer, _deltaReadBytes, _readCommandBuffer, 2, &_i2crb);
+        _lastDigitalRead = currentMicros;
+        _readState = RDS_DELTA;
+      }
+    } else if (_readState == RDS_IDLE) {
+      if (_numDigitalPins == 0) _fullReadPending &= ~FULL_READ_DIGITAL;
+      if (_numAnaloguePins == 0) _fullReadPending &= ~FULL_READ_ANALOGUE;
       if (_numDigitalPins>0 && currentMicros - _lastDigitalRead > _digitalRefresh) { // Delay for digital read refresh
         // Issue new read request for digital states.  As the request is non-blocking, the buffer has to
         // be allocated from heap (object state).
@@ -303,37 +396,19 @@ private:
     return value;
   }
 
-  // Write digital value.  We could have an output buffer of states, that is periodically
-  // written to the device if there are any changes; this would reduce the I2C overhead
-  // if lots of output requests are being made.  We could also cache the last value 
-  // sent so that we don't write the same value over and over to the output.  
-  // However, for the time being, we just write the current value (blocking I2C) to the
-  // IOExpander node.  As it is a blocking request, we can use buffers allocated from
-  // the stack to save RAM allocation.
+  // Write digital value.  The command is queued and sent by _loop, so a
+  // sequence of writes doesn't wait for each one to be acknowledged.
   void _write(VPIN vpin, int value) override {
-    uint8_t digitalOutBuffer[3];
-    uint8_t responseBuffer[1];
     if (_deviceState == DEVSTATE_FAILED) return;
     int pin = vpin - _firstVpin;
-    digitalOutBuffer[0] = EXIOWRD;
-    digitalOutBuffer[1] = pin;
-    digitalOutBuffer[2] = value;
-    uint8_t status = I2CManager.read(_I2CAddress, responseBuffer, 1, digitalOutBuffer, 3);
-    if (status != I2C_STATUS_OK) {
-      reportError(status);
-    } else {
-      if (responseBuffer[0] != EXIORDY) {
-        DIAG(F("Vpin %u cannot be used as a digital output pin"), (int)vpin);
-      }
-    }
+    uint8_t digitalOutBuffer[3] = {EXIOWRD, (uint8_t)pin, (uint8_t)value};
+    queueOutbound(digitalOutBuffer, sizeof(digitalOutBuffer));
   }
 
-  // Write analogue (integer) value.  Write the parameters (blocking I2C) to the
-  // IOExpander node.  As it is a blocking request, we can use buffers allocated from
-  // the stack to reduce RAM allocation.
+  // Write analogue (integer) value.  As for _write, the command is queued
+  // and sent by _loop.
   void _writeAnalogue(VPIN vpin, int value, uint8_t profile, uint16_t duration) override {
     uint8_t servoBuffer[7];
-    uint8_t responseBuffer[1];
 
     if (_deviceState == DEVSTATE_FAILED) return;
     int pin = vpin - _firstVpin;
@@ -348,14 +423,63 @@ private:
     servoBuffer[4] = profile;
     servoBuffer[5] = duration & 0xFF;
     servoBuffer[6] = duration >> 8;
-    uint8_t status = I2CManager.read(_I2CAddress, responseBuffer, 1, servoBuffer, 7);
+    queueOutbound(servoBuffer, sizeof(servoBuffer));
+  }
+
+  // Add a write command to the outbound queue.  If a command of the same type
+  // for the same pin is still waiting, it is overwritten, as only the latest
+  // value matters.  If the queue is full the command is discarded; nothing 
+  // here waits for the I2C bus.
+  void queueOutbound(const uint8_t command[], uint8_t length) {
+    uint8_t index = _outHead;
+    for (uint8_t i = 0; i < _outCount; i++) {
+      OutboundCommand *entry = &_outQueue[index];
+      if (entry->buffer[0] == command[0] && entry->buffer[1] == command[1]) {
+        memcpy(entry->buffer, command, length);
+        return;
+      }
+      if (++index >= OUTBOUND_QUEUE_SIZE) index = 0;
+    }
+    if (_outCount >= OUTBOUND_QUEUE_SIZE) {
+      DIAG(F("EX-IOExpander I2C:%s write queue full, Vpin %u not written"), 
+        _I2CAddress.toString(), (int)(_firstVpin + command[1]));
+      return;
+    }
+    index = _outHead + _outCount;
+    if (index >= OUTBOUND_QUEUE_SIZE) index -= OUTBOUND_QUEUE_SIZE;
+    memcpy(_outQueue[index].buffer, command, length);
+    _outQueue[index].length = length;
+    _outCount++;
+  }
+
+  // Called from _loop.  Check the result of the last write sent and, if the
+  // request block is free, send the next one from the queue.
+  void processOutbound() {
+    if (_writeInProgress) {
+      if (_writeI2crb.isBusy()) return;
+      _writeInProgress = false;
+      checkOutboundResponse(_writeI2crb.status, _writeCommandBuffer, _writeResponseBuffer[0]);
+      if (_deviceState == DEVSTATE_FAILED) return;
+    }
+    if (_outCount == 0) return;
+    OutboundCommand *entry = &_outQueue[_outHead];
+    memcpy(_writeCommandBuffer, entry->buffer, entry->length);
+    I2CManager.read(_I2CAddress, _writeResponseBuffer, 1, _writeCommandBuffer, entry->length, &_writeI2crb);
+    _writeInProgress = true;
+    if (++_outHead >= OUTBOUND_QUEUE_SIZE) _outHead = 0;
+    _outCount--;
+  }
+
+  // Report any problem with a write once its response has been received.
+  void checkOutboundResponse(uint8_t status, const uint8_t command[], uint8_t response) {
     if (status != I2C_STATUS_OK) {
-      DIAG(F("EX-IOExpander I2C:%s Error:%d %S"), _I2CAddress.toString(), status, I2CManager.getErrorMessage(status));
-      _deviceState = DEVSTATE_FAILED;
-    } else {
-      if (responseBuffer[0] != EXIORDY) {
+      reportError(status);
+    } else if (response != EXIORDY) {
+      VPIN vpin = _firstVpin + command[1];
+      if (command[0] == EXIOWRAN)
         DIAG(F("Vpin %u cannot be used as a servo/PWM pin"), (int)vpin);
-      }
+      else
+        DIAG(F("Vpin %u cannot be used as a digital output pin"), (int)vpin);
     }
   }
 
@@ -385,15 +509,41 @@ private:
   uint8_t* _digitalInputStates  = NULL;
   uint8_t* _analogueInputStates = NULL;
   uint8_t* _analogueInputBuffer = NULL;  // buffer for I2C input transfers
-  uint8_t _readCommandBuffer[1];
+  uint8_t _readCommandBuffer[2];
 
   uint8_t _digitalPinBytes = 0;   // Size of allocated memory buffer (may be longer than needed)
   uint8_t _analoguePinBytes = 0;  // Size of allocated memory buffer (may be longer than needed)
   uint8_t* _analoguePinMap = NULL;
   I2CRB _i2crb;
 
-  enum {RDS_IDLE, RDS_DIGITAL, RDS_ANALOGUE};  // Read operation states
+  // Queue of write commands waiting to be sent, and the request block and
+  // buffers for the one currently being sent.
+  struct OutboundCommand {
+    uint8_t length;
+    uint8_t buffer[7];
+  };
+  static const uint8_t OUTBOUND_QUEUE_SIZE = EXIO_OUTBOUND_QUEUE_SIZE;
+  OutboundCommand _outQueue[OUTBOUND_QUEUE_SIZE];
+  uint8_t _outHead = 0;
+  uint8_t _outCount = 0;
+  I2CRB _writeI2crb;
+  uint8_t _writeCommandBuffer[7];
+  uint8_t _writeResponseBuffer[1];
+  bool _writeInProgress = false;
+
+  enum {RDS_IDLE, RDS_DIGITAL, RDS_ANALOGUE, RDS_DELTA};  // Read operation states
   uint8_t _readState = RDS_IDLE;
+
+  // Delta read support
+  bool _deltaSupported = false;
+  bool _deltaSynced = false;
+  uint8_t _deltaSequence = 0;
+  uint8_t* _deltaBuffer = NULL;
+  uint8_t _deltaBufferBytes = 0;  // Size of allocated memory buffer
+  uint8_t _deltaReadBytes = 0;    // Size of delta read transfer
+  const uint8_t _analogueDeadband = 2;  // Analogue change sent by device if more than this
+  enum {FULL_READ_DIGITAL = 1, FULL_READ_ANALOGUE = 2};
+  uint8_t _fullReadPending = 0;   // Full reads needed before using delta reads
   
   unsigned long _lastDigitalRead = 0;
   unsigned long _lastAnalogueRead = 0;
@@ -413,6 +563,7 @@ private:
     EXIOINITA = 0xE8,   // Flag we're receiving analogue pin mappings
     EXIOPINS = 0xE9,    // Flag we're receiving pin counts for buffers
     EXIOWRAN = 0xEA,   // Flag we're sending an analogue write (PWM)
+    EXIORDDELTA = 0xEB, // Flag to read changed inputs since last delta read
     EXIOERR = 0xEF,     // Flag we've received an error
   };
 };
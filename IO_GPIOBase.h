@@ -100,7 +100,7 @@ void GPIOBase<T>::_begin() {
     pinMode(_gpioInterruptPin, INPUT_PULLUP);
 
   I2CManager.begin();
-  I2CManager.setClock(400000);
+  I2CManager.setClock(_I2CAddress, 400000);
   if (I2CManager.exists(_I2CAddress)) {
 #if defined(DIAG_IO)
     _display();
@@ -161,16 +161,10 @@ void GPIOBase<T>::_loop(unsigned long currentMicros) {
 
     // Scan for changes in input states and invoke callback (if present)
     T differences = lastPortStates ^ _portInputState;
-    if (differences && IONotifyCallback::hasCallback()) {
-      // Scan for differences bit by bit
-      T mask = 1;
-      for (int pin=0; pin<_nPins; pin++) {
-        if (differences & mask) {
-          // Change detected.
-          IONotifyCallback::invokeAll(_firstVpin+pin, (_portInputState & mask) == 0);
-        }
-        mask <<= 1;
-      }
+    if (differences) {
+      // Notify the whole port in one go; input is active when the pin is low.
+      // Only the callbacks whose range overlaps the port are visited.
+      IONotifyCallback::invokeAll(_firstVpin, _nPins, differences, (T)~_portInputState);
     }
 
     #ifdef DIAG_IO
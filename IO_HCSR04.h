@@ -45,6 +45,13 @@
  * And 58us corresponds to 1cm in the calculation, so the effect of
  * interrupts is negligible.
  *
+ * Where the echo pin supports an external interrupt, the edges of the echo
+ * pulse are timestamped by an interrupt handler and _loop only processes the
+ * completed result, so the loop is never held up waiting for the echo.  Only
+ * one such sensor is triggered at a time; the sensors take it in turn, so
+ * the echo from one cannot be picked up by another.  Echo pins without an
+ * interrupt (e.g. most pins on a Mega) fall back to the polled measurement.
+ *
  * Note: The timing accuracy required for measuring the pulse length means that
  * the pins have to be direct Arduino pins; GPIO pins on an IO Extender cannot
  * provide the required accuracy.
@@ -69,6 +76,10 @@
 
 #include "IODevice.h"
 
+#if !defined(IRAM_ATTR)
+#define IRAM_ATTR
+#endif
+
 class HCSR04 : public IODevice {
 
 private:
@@ -90,10 +101,20 @@ private:
   const uint16_t maxPermittedLoopTime = 10 * factor; // max in us
   unsigned long _startTime = 0;
   unsigned long _maxTime = 0;
-  enum {DORMANT, MEASURING}; // _state values
+  enum {DORMANT, MEASURING, SETTLING}; // _state values
   uint8_t _state = DORMANT;
   uint8_t _counter = 0;
   uint16_t _options = 0;
+  // Interrupt driven measurement.  The interrupt handler records the echo
+  // edges for the sensor currently holding the _activeSensor token.
+  bool _useInterrupt = false;
+  enum {ECHO_WAITING, ECHO_STARTED, ECHO_COMPLETE}; // _echoState values
+  volatile uint8_t _echoState = ECHO_WAITING;
+  volatile unsigned long _echoStart = 0;
+  volatile unsigned long _echoEnd = 0;
+  // Longest echo pulse generated by the HC-SR04 (no object detected).
+  const unsigned long maxEchoTime = 40000UL; // us
+  static HCSR04 * volatile _activeSensor;
 
 public:
   enum Options {
@@ -124,6 +145,15 @@ protected:
     pinMode(_trigPin, OUTPUT);
     pinMode(_echoPin, INPUT);
     ArduinoPins::fastWriteDigital(_trigPin, 0);
+    if (!(_options & LOOP)) {
+#if defined(NOT_AN_INTERRUPT)
+      if (digitalPinToInterrupt(_echoPin) != NOT_AN_INTERRUPT)
+#endif
+      {
+        attachInterrupt(digitalPinToInterrupt(_echoPin), echoISR, CHANGE);
+        _useInterrupt = true;
+      }
+    }
 #if defined(DIAG_IO)
     _display();
 #endif
@@ -140,8 +170,110 @@ protected:
     return _distance;
   }
 
+  // Interrupt handler, shared by all HC-SR04 devices.  Timestamps the start
+  // and end of the echo pulse for the sensor that has been triggered.
+  static void IRAM_ATTR echoISR() {
+    HCSR04 *sensor = _activeSensor;
+    if (sensor == NULL) return;
+    unsigned long now = micros();
+    if (ArduinoPins::fastReadDigital(sensor->_echoPin)) {
+      if (sensor->_echoState == ECHO_WAITING) {
+        sensor->_echoStart = now;
+        sensor->_echoState = ECHO_STARTED;
+      }
+    } else if (sensor->_echoState == ECHO_STARTED) {
+      sensor->_echoEnd = now;
+      sensor->_echoState = ECHO_COMPLETE;
+    }
+  }
+
+  // Echo pulse measured, update value and distance.
+  void setPulseLength(unsigned long pulseLength) {
+    if (pulseLength <= factor * _onThreshold) {
+      // Measured time is within the onThreshold, so value is one.
+      _value = 1;
+      // If the new distance value is less than the current, use it immediately.
+      // But if the new distance value is longer, then it may be erroneously long
+      // (because of extended loop times delays), so apply a delay to distance increases.
+      uint16_t estimatedDistance = pulseLength / factor;
+      if (estimatedDistance < _distance) 
+        _distance = estimatedDistance;
+      else
+        _distance += 1;  // Just increase distance slowly.
+      _counter = 0;
+      //DIAG(F("HCSR04: Pulse Len=%l Distance=%d"), pulseLength, _distance);
+    }
+  }
+
+  // Echo pulse longer than the offThreshold.
+  void setPulseTooLong() {
+    // Pulse length longer than maxTime, value is provisionally zero.
+    // But don't change _value unless provisional value is zero for 10 consecutive measurements
+    if (_value == 1) {
+      if (++_counter >= 10) {
+        _value = 0;
+        _distance = 32767;
+        _counter = 0;
+      }
+    }
+  }
+
+  // _loop function for interrupt driven measurement.  Never waits; the
+  // trigger is sent on one entry and the result collected on a later one.
+  void interruptLoop(unsigned long currentMicros) {
+    unsigned long elapsed = currentMicros - _startTime;
+    switch(_state) {
+      case DORMANT:
+        // Wait for any other sensor's measurement to finish.
+        if (_activeSensor != NULL) return;
+        // If receive pin is still set on from previous call, do nothing till next entry.
+        if (ArduinoPins::fastReadDigital(_echoPin)) return;
+        _echoState = ECHO_WAITING;
+        _activeSensor = this;
+        // Send 10us pulse to trigger transmitter
+        ArduinoPins::fastWriteDigital(_trigPin, 1);
+        delayMicroseconds(10);
+        ArduinoPins::fastWriteDigital(_trigPin, 0);
+        _startTime = micros();
+        _maxTime = factor * _offThreshold;
+        _state = MEASURING;
+        return;
+
+      case MEASURING:
+        if (_echoState == ECHO_COMPLETE) {
+          noInterrupts();
+          unsigned long pulseLength = _echoEnd - _echoStart;
+          interrupts();
+          setPulseLength(pulseLength);
+          break;
+        } else if (_echoState == ECHO_WAITING) {
+          // Measured time delay to start of echo is just under 500us, 
+          // so abort the read if nothing after 1000us.
+          if (elapsed > 1000) break;
+        } else if (currentMicros - _echoStart > _maxTime) {
+          // Beyond the offThreshold, but keep the sensor active until the
+          // echo ends so that the next sensor can't see this one's ping.
+          setPulseTooLong();
+          _state = SETTLING;
+        }
+        return;
+
+      case SETTLING:
+        if (_echoState != ECHO_COMPLETE && elapsed < maxEchoTime) return;
+        break;
+    }
+    _activeSensor = NULL;
+    _state = DORMANT;
+    // Datasheet recommends a wait of at least 60ms between measurement cycles
+    delayUntil(currentMicros+60000UL);
+  }
+
   // _loop function - read HC-SR04 once every 100 milliseconds.
   void _loop(unsigned long currentMicros) override {
+    if (_useInterrupt) {
+      interruptLoop(currentMicros);
+      return;
+    }
     unsigned long waitTime;
     switch(_state) {
       case DORMANT: // Issue pulse
@@ -187,35 +319,14 @@ protected:
           waitTime = micros() - _startTime;
           if (!ArduinoPins::fastReadDigital(_echoPin)) {
             // Echo pulse completed; check if pulse length is below threshold and if so set value.
-            if (waitTime <= factor * _onThreshold) {
-              // Measured time is within the onThreshold, so value is one.
-              _value = 1;
-              // If the new distance value is less than the current, use it immediately.
-              // But if the new distance value is longer, then it may be erroneously long
-              // (because of extended loop times delays), so apply a delay to distance increases.
-              uint16_t estimatedDistance = waitTime / factor;
-              if (estimatedDistance < _distance) 
-                _distance = estimatedDistance;
-              else
-                _distance += 1;  // Just increase distance slowly.
-              _counter = 0;
-              //DIAG(F("HCSR04: Pulse Len=%l Distance=%d"), waitTime, _distance);
-            }
+            setPulseLength(waitTime);
             _state = DORMANT;
           } else {
             // Echo pulse hasn't finished, so check if maximum time has elapsed
             // If pulse is too long then set return value to zero,
             //  and finish without waiting for end of pulse.
             if (waitTime > _maxTime) {
-              // Pulse length longer than maxTime, value is provisionally zero.
-              // But don't change _value unless provisional value is zero for 10 consecutive measurements
-              if (_value == 1) {
-                if (++_counter >= 10) {
-                  _value = 0;
-                  _distance = 32767;
-                  _counter = 0;
-                }
-              }
+              setPulseTooLong();
               _state = DORMANT; // start again
             }
           }
@@ -234,8 +345,9 @@ protected:
   }
 
   void _display() override {
-    DIAG(F("HCSR04 Configured on VPIN:%u TrigPin:%d EchoPin:%d On:%dcm Off:%dcm"),
-      _firstVpin, _trigPin, _echoPin, _onThreshold, _offThreshold);
+    DIAG(F("HCSR04 Configured on VPIN:%u TrigPin:%d EchoPin:%d On:%dcm Off:%dcm %S"),
+      _firstVpin, _trigPin, _echoPin, _onThreshold, _offThreshold,
+      _useInterrupt ? F("Interrupt") : F("Polled"));
   }
 
 };
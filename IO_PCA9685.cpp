@@ -94,7 +94,7 @@ PCA9685::PCA9685(VPIN firstVpin, int nPins, I2CAddress i2cAddress, uint16_t freq
 // Device-specific initialisation
 void PCA9685::_begin() {
   I2CManager.begin();
-  I2CManager.setClock(1000000); // Nominally able to run up to 1MHz on I2C
+  I2CManager.setClock(_I2CAddress, 1000000); // Nominally able to run up to 1MHz on I2C
           // In reality, other devices including the Arduino will limit 
           // the clock speed to a lower rate.
 
@@ -0,0 +1,107 @@
+/*
+ *  © 2024, DCC-EX contributors. All rights reserved.
+ *
+ *  This file is part of DCC-EX API
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CommandStation.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * ShiftEngine clocks bits in or out of a bit-banged serial device (shift
+ * register chain, TTP229 keypad etc) a few bits at a time, so that a long
+ * transfer is spread over several entries to a device's _loop instead of
+ * holding up the CS loop until it is complete.
+ *
+ * The device starts a transfer with startInput() or startOutput() and then
+ * calls run() from each _loop entry.  run() returns true when the transfer
+ * has completed, in the same way as I2CRB::isBusy() is polled for I2C.
+ *
+ * Bits are numbered from 0, bit n being (0x80 >> n%8) in buffer[n/8].
+ * Input bits are read in order from bit 0; output bits are sent from the
+ * highest numbered bit down to bit 0.
+ */
+
+#ifndef IO_ShiftEngine_h
+#define IO_ShiftEngine_h
+
+#include <Arduino.h>
+#include "IODevice.h"
+
+class ShiftEngine {
+public:
+  enum Mode : uint8_t {
+    INPUT_FALLING,  // Clock idles high, data read after falling edge (74HC165)
+    INPUT_RISING,   // Clock idles high, data read after rising edge (TTP229)
+    OUTPUT_RISING,  // Clock idles low, data shifted on rising edge (74HC595)
+  };
+
+  ShiftEngine(VPIN clockPin, VPIN dataPin, Mode mode) :
+    _clockPin(clockPin), _dataPin(dataPin), _mode(mode) {}
+
+  void startInput(byte *buffer, uint16_t nBits) {
+    _buffer = buffer;
+    _nBits = nBits;
+    _bit = 0;
+  }
+
+  void startOutput(const byte *buffer, uint16_t nBits) {
+    _buffer = (byte *)buffer;
+    _nBits = nBits;
+    _bit = 0;
+  }
+
+  // Clock up to maxBits more bits.  Returns true when the transfer is complete.
+  bool run(uint8_t maxBits) {
+    while (_bit < _nBits && maxBits-- > 0) {
+      byte mask = 0x80 >> (_bit % 8);
+      if (_mode == OUTPUT_RISING) {
+        uint16_t n = _nBits - 1 - _bit;
+        ArduinoPins::fastWriteDigital(_dataPin, _buffer[n/8] & (0x80 >> (n % 8)));
+        ArduinoPins::fastWriteDigital(_clockPin, HIGH);
+        ArduinoPins::fastWriteDigital(_clockPin, LOW);
+      } else {
+        bool data;
+        ArduinoPins::fastWriteDigital(_clockPin, LOW);
+        delayMicroseconds(1);
+        if (_mode == INPUT_FALLING) {
+          data = ArduinoPins::fastReadDigital(_dataPin);
+          ArduinoPins::fastWriteDigital(_clockPin, HIGH);
+        } else {
+          ArduinoPins::fastWriteDigital(_clockPin, HIGH);
+          data = ArduinoPins::fastReadDigital(_dataPin);
+        }
+        delayMicroseconds(1);
+        if (data) _buffer[_bit/8] |= mask;
+        else _buffer[_bit/8] &= ~mask;
+      }
+      _bit++;
+    }
+    return !isBusy();
+  }
+
+  bool isBusy() { return _bit < _nBits; }
+
+  // Abandon any transfer in progress.
+  void cancel() { _bit = _nBits; }
+
+private:
+  VPIN _clockPin;
+  VPIN _dataPin;
+  Mode _mode;
+  byte *_buffer = NULL;
+  uint16_t _nBits = 0;
+  uint16_t _bit = 0;
+};
+
+#endif // IO_ShiftEngine_h
@@ -45,6 +45,7 @@
 #define IO_TOUCHKEYPAD_H
 
 #include "IODevice.h"
+#include "IO_ShiftEngine.h"
 
 class TouchKeypad : public IODevice {
 private:
@@ -52,6 +53,8 @@ private:
   uint16_t _inputStates = 0;
   VPIN _clockPin;
   VPIN _dataPin;
+  ShiftEngine _shifter;
+  byte _shiftBuffer[2];
 
 public:
   //  Static function to handle create calls.
@@ -61,7 +64,8 @@ public:
 
 protected:
   // Constructor. 
-  TouchKeypad(VPIN firstVpin, int nPins, VPIN clockPin, VPIN dataPin) {
+  TouchKeypad(VPIN firstVpin, int nPins, VPIN clockPin, VPIN dataPin) :
+    _shifter(clockPin, dataPin, ShiftEngine::INPUT_RISING) {
     _firstVpin = firstVpin;
     _nPins = (nPins > 16) ? 16 : nPins;  // Maximum of 16 pads per device
     _clockPin = clockPin;
@@ -100,18 +104,20 @@ protected:
   // provide a good enough response time.
   // Maximum clock frequency is 512kHz, so put a 1us delay
   // between clock transitions.
+  // All 16 bits are clocked in on one entry.  If the clock were held idle
+  // for 2ms part way through, the device would restart its output, and 
+  // with other devices sharing the loop that gap can't be guaranteed.
   //
   void _loop(unsigned long currentMicros) {
 
-    // Clock 16 bits from the device
+    _shifter.startInput(_shiftBuffer, 16);
+    _shifter.run(16);
+
+    // Data is active-low, first bit is pad 1
     uint16_t data = 0, maskBit = 0x01;
     for (uint8_t pad=0; pad<16; pad++) {
-      ArduinoPins::fastWriteDigital(_clockPin, 0);
-      delayMicroseconds(1);
-      ArduinoPins::fastWriteDigital(_clockPin, 1);
-      data |= (ArduinoPins::fastReadDigital(_dataPin) ? 0 : maskBit);
+      if (!(_shiftBuffer[pad/8] & (0x80 >> (pad%8)))) data |= maskBit;
       maskBit <<= 1;
-      delayMicroseconds(1);
     }
     _inputStates = data;
 #ifdef DIAG_IO
@@ -22,6 +22,7 @@
 #include <Arduino.h>
 #include "defines.h"
 #include "IODevice.h"
+#include "IO_ShiftEngine.h"
 
 #define DN_PIN_MASK(bit) (0x80>>(bit%8))
 #define DN_GET_BIT(x) (_pinValues[(x)/8] & DN_PIN_MASK((x)) )
@@ -36,7 +37,8 @@ public:
   IO_duinoNodes(VPIN firstVpin, int nPins, 
                 byte clockPin, byte latchPin, byte dataPin, 
                 const byte* pinmap) :
-    IODevice(firstVpin, nPins) {
+    IODevice(firstVpin, nPins),
+    _shifter(clockPin, dataPin, pinmap ? ShiftEngine::INPUT_FALLING : ShiftEngine::OUTPUT_RISING) {
  
    _latchPin=latchPin;
     _clockPin=clockPin;
@@ -44,6 +46,7 @@ public:
     _pinMap=pinmap;
     _nShiftBytes=(nPins+7)/8; // rounded up to multiples of 8 bits
     _pinValues=(byte*) calloc(_nShiftBytes,1);  
+    _shiftBuffer=(byte*) calloc(_nShiftBytes,1);  
     // Connect to HAL so my _write, _read and _loop will be called as required.
     IODevice::addDevice(this);  
   }
@@ -55,38 +58,37 @@ public:
     pinMode(_clockPin,OUTPUT);
     pinMode(_dataPin,_pinMap?INPUT_PULLUP:OUTPUT);
     _display();
-    if (!_pinMap) _loopOutput();
+    if (!_pinMap) _xmitPending=true;
   }
 
 // loop called by HAL supervisor 
+// The shift register chain is clocked a few bytes at a time on each entry, 
+// so a long chain doesn't hold up the loop.
 void _loop(unsigned long currentMicros) override {
     if (_pinMap) _loopInput(currentMicros);
-    else if (_xmitPending) _loopOutput();
+    else _loopOutput();
 }
 
 void _loopInput(unsigned long currentMicros)  {
    
-   if (currentMicros-_prevMicros < POLL_MICROS) return; // Nothing to do
+  if (!_shifter.isBusy()) {
+    if (currentMicros-_prevMicros < POLL_MICROS) return; // Nothing to do
     _prevMicros=currentMicros;
    
     //set latch to HIGH to freeze & store parallel data
-   ArduinoPins::fastWriteDigital(_latchPin, HIGH);
-   delayMicroseconds(1);
-   //set latch to LOW to enable the data to be transmitted serially
-   ArduinoPins::fastWriteDigital(_latchPin, LOW);
+    ArduinoPins::fastWriteDigital(_latchPin, HIGH);
+    delayMicroseconds(1);
+    //set latch to LOW to enable the data to be transmitted serially
+    ArduinoPins::fastWriteDigital(_latchPin, LOW);
+    _shifter.startInput(_shiftBuffer, _nShiftBytes*8);
+  }
+  if (!_shifter.run(BITS_PER_ENTRY)) return; // more to come
 
-  // stream in the bitmap using mapping order provided at constructor   
+  // Apply mapping order provided at constructor to the bitmap streamed in   
   for (int xmitByte=0;xmitByte<_nShiftBytes; xmitByte++) {
       byte newByte=0;
       for (int xmitBit=0;xmitBit<8; xmitBit++) {
-        ArduinoPins::fastWriteDigital(_clockPin, LOW);
-        delayMicroseconds(1);
-        bool data = ArduinoPins::fastReadDigital(_dataPin);  
-        byte map=_pinMap[xmitBit];
-        if (data)  newByte |= map;
-            else   newByte &= ~map;
-        ArduinoPins::fastWriteDigital(_clockPin, HIGH); 
-        delayMicroseconds(1);   
+        if (_shiftBuffer[xmitByte] & (0x80>>xmitBit)) newByte |= _pinMap[xmitBit];
       }
       _pinValues[xmitByte]=newByte;
       // DIAG(F("DIN %x=%x"),xmitByte, newByte);
@@ -95,14 +97,16 @@ void _loopInput(unsigned long currentMicros)  {
 
 void _loopOutput()  {
     // stream out the bitmap (highest pin first)
-    _xmitPending=false; 
-    ArduinoPins::fastWriteDigital(_latchPin, LOW);
-    for (int xmitBit=_nShiftBytes*8 -1; xmitBit>=0; xmitBit--) {
-        ArduinoPins::fastWriteDigital(_dataPin,DN_GET_BIT(xmitBit));
-        ArduinoPins::fastWriteDigital(_clockPin,HIGH);
-        ArduinoPins::fastWriteDigital(_clockPin,LOW);
-    }  
-    ArduinoPins::fastWriteDigital(_latchPin, HIGH);
+    if (!_shifter.isBusy()) {
+      if (!_xmitPending) return;
+      _xmitPending=false; 
+      // Take a copy so that writes during the transfer are sent next time
+      memcpy(_shiftBuffer, _pinValues, _nShiftBytes);
+      ArduinoPins::fastWriteDigital(_latchPin, LOW);
+      _shifter.startOutput(_shiftBuffer, _nShiftBytes*8);
+    }
+    if (_shifter.run(BITS_PER_ENTRY))
+      ArduinoPins::fastWriteDigital(_latchPin, HIGH);
   }
 
   int _read(VPIN vpin) override {
@@ -130,6 +134,9 @@ void _loopOutput()  {
 
 private:
   static const unsigned long POLL_MICROS=100000; // 10 / S
+  static const uint8_t BITS_PER_ENTRY=16; // bits shifted on each loop entry
+  ShiftEngine _shifter;
+  byte* _shiftBuffer; // bits being shifted in or out
   unsigned long _prevMicros; 
   int  _nShiftBytes=0; 
   VPIN _latchPin,_clockPin,_dataPin;
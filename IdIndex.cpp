@@ -0,0 +1,87 @@
+/*
+ *  © 2024, DCC-EX contributors. All rights reserved.
+ *  
+ *  This file is part of CommandStation-EX
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CommandStation.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IdIndex.h"
+#include "DIAG.h"
+
+// Find object with the given id, or NULL if not present.
+void *IdIndex::find(uint16_t id) {
+  if (!_table) return NULL;
+  uint16_t mask = (1U << _bits) - 1;
+  for (uint16_t i = home(id); _table[i]; i = (i + 1) & mask)
+    if (_getId(_table[i]) == id) return _table[i];
+  return NULL;
+}
+
+// Add an object.  The caller ensures that its id isn't already present.
+void IdIndex::insert(void *object) {
+  if (_failed) return;
+  if (!_table || (uint32_t)(_count + 1) * 4 > (3UL << _bits)) {
+    resize(_table ? _bits + 1 : 3);
+    if (_failed) return;
+  }
+  uint16_t mask = (1U << _bits) - 1;
+  uint16_t i = home(_getId(object));
+  while (_table[i]) i = (i + 1) & mask;
+  _table[i] = object;
+  _count++;
+}
+
+// Remove the object with the given id.  Following entries in the same
+// run of occupied slots are moved back so that no tombstones are needed.
+void IdIndex::remove(uint16_t id) {
+  if (!_table) return;
+  uint16_t mask = (1U << _bits) - 1;
+  uint16_t i = home(id);
+  for ( ; _table[i]; i = (i + 1) & mask)
+    if (_getId(_table[i]) == id) break;
+  if (!_table[i]) return;   // Not found
+  _table[i] = NULL;
+  _count--;
+  for (uint16_t j = (i + 1) & mask; _table[j]; j = (j + 1) & mask) {
+    uint16_t k = home(_getId(_table[j]));
+    // Move entry j into the hole at i unless its home slot lies cyclically 
+    // in (i, j], in which case it is still reachable from its home slot.
+    bool reachable = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+    if (!reachable) {
+      _table[i] = _table[j];
+      _table[j] = NULL;
+      i = j;
+    }
+  }
+}
+
+// Reallocate the table with 2^bits slots and re-insert the entries.
+void IdIndex::resize(uint8_t bits) {
+  void **oldTable = _table;
+  uint16_t oldSize = oldTable ? (1U << _bits) : 0;
+  _table = (bits <= 15) ? (void **)calloc(1UL << bits, sizeof(void *)) : NULL;
+  if (!_table) {
+    DIAG(F("IdIndex: insufficient memory, using list"));
+    free(oldTable);
+    _failed = true;
+    _count = 0;
+    return;
+  }
+  _bits = bits;
+  _count = 0;
+  for (uint16_t i = 0; i < oldSize; i++)
+    if (oldTable[i]) insert(oldTable[i]);
+  free(oldTable);
+}
@@ -0,0 +1,56 @@
+/*
+ *  © 2024, DCC-EX contributors. All rights reserved.
+ *  
+ *  This file is part of CommandStation-EX
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CommandStation.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef IdIndex_h
+#define IdIndex_h
+
+#include <Arduino.h>
+
+/*
+ * IdIndex is an open-addressing hash table of object pointers, keyed on
+ * a 16-bit id, used alongside the linked lists of turnouts and outputs so
+ * that get(id) doesn't have to walk the list.  The list is still used 
+ * for listings so that objects are shown in the order they were created.
+ * 
+ * Only the pointers are held in the table; the id of an object is obtained
+ * through the getId function supplied by the owning class.  The table
+ * grows as objects are added, keeping it no more than 3/4 full.  If memory 
+ * for the table can't be allocated, the index is disabled and isValid() 
+ * returns false, in which case the owner must walk its list instead.
+ */
+class IdIndex {
+public:
+  typedef uint16_t GetIdFunction(void *object);
+  IdIndex(GetIdFunction *getId) { _getId = getId; }
+  void *find(uint16_t id);
+  void insert(void *object);
+  void remove(uint16_t id);
+  inline bool isValid() { return !_failed; }
+
+private:
+  // Home slot for an id (multiplicative hash, using the top bits).
+  inline uint16_t home(uint16_t id) { return (uint16_t)(id * 40503U) >> (16 - _bits); }
+  void resize(uint8_t bits);
+  GetIdFunction *_getId;
+  void **_table = NULL;
+  uint16_t _count = 0;
+  uint8_t _bits = 0;   // Table size is 2^_bits
+  bool _failed = false;
+};
+
+#endif
@@ -22,9 +22,14 @@
 #include "Turnouts.h"
 #include "Sensors.h"
 
-int  LCN::id = 0;
+uint32_t LCN::id = 0;
 Stream * LCN::stream=NULL;
 bool LCN::firstLoop=true;
+byte LCN::peerVersion=0;
+int LCN::bulkSensorId=0;
+LCN::PendingItem LCN::pending[LCN::MAX_PENDING];
+byte LCN::pendingCount=0;
+unsigned long LCN::pendingSince=0;
 
 void LCN::init(Stream & lcnstream) {
   stream=&lcnstream; 
@@ -33,6 +38,11 @@ void LCN::init(Stream & lcnstream) {
 
 
 // Inbound LCN traffic is postfix notation...   nnnX  where nnn is an id, X is the opcode
+// Peers that understand batching announce themselves with nnnV (nnn is the 
+// protocol version, 2 or more), and may then report sensors in bulk:
+//   nnnB     sets the id of the first sensor in the next bulk frame
+//   mmmb     mmm is a 16 bit mask of states for the next 16 sensors, 
+//            bit 0 being the first.  The first sensor id then moves on by 16.
 void LCN::loop() {
   if (!stream) return;
   if (firstLoop) {
@@ -47,30 +57,82 @@ void LCN::loop() {
       id = 10 * id + ch - '0';
     }
     else if (ch == 't' || ch == 'T') { // Turnout opcodes
-      if (Diag::LCN) DIAG(F("LCN IN %d%c"),id,(char)ch);
+      if (Diag::LCN) DIAG(F("LCN IN %d%c"),(int)id,(char)ch);
       if (!Turnout::exists(id)) LCNTurnout::create(id);
       Turnout::setClosedStateOnly(id,ch=='t');
       id = 0;
     }
     else if (ch == 'y' || ch == 'Y') { // Turnout opcodes
-      if (Diag::LCN) DIAG(F("LCN IN %d%c"),id,(char)ch);
+      if (Diag::LCN) DIAG(F("LCN IN %d%c"),(int)id,(char)ch);
       Turnout::setClosed(id,ch=='y');
       id = 0;
     }
     else if (ch == 'S' || ch == 's') {
-      if (Diag::LCN) DIAG(F("LCN IN %d%c"),id,(char)ch);
+      if (Diag::LCN) DIAG(F("LCN IN %d%c"),(int)id,(char)ch);
       Sensor * ss = Sensor::get(id);
       if (!ss) ss = Sensor::create(id, VPIN_NONE, 0); // impossible pin
       ss->setState(ch == 'S');
       id = 0;
     }
+    else if (ch == 'B') { // Bulk sensor frame base id
+      bulkSensorId = id;
+      id = 0;
+    }
+    else if (ch == 'b') { // Bulk sensor states
+      if (Diag::LCN) DIAG(F("LCN IN %d/%lb"), bulkSensorId, id);
+      for (byte bit=0; bit<16; bit++) {
+        int sid = bulkSensorId + bit;
+        bool state = id & (1UL << bit);
+        Sensor * ss = Sensor::get(sid);
+        // Only create sensors that are reported active.
+        if (!ss && state) ss = Sensor::create(sid, VPIN_NONE, 0);
+        if (ss) ss->setState(state);
+      }
+      bulkSensorId += 16;
+      id = 0;
+    }
+    else if (ch == 'V') { // Peer protocol version
+      peerVersion = id;
+      DIAG(F("LCN peer protocol version %d"), peerVersion);
+      id = 0;
+    }
     else  id = 0; // ignore any other garbage from LCN
   }
+
+  // Send any batched changes once the batching window has expired.
+  if (pendingCount > 0 && millis() - pendingSince >= LCN_BATCH_MS) 
+    flush();
 }
 
+// Queue a change for sending.  A change to an item already pending 
+// replaces the earlier state, so only the latest state is sent.
 void LCN::send(char opcode, int id, bool state) {
-   if (stream) {
-      StringFormatter::send(stream,F("%c/%d/%d"), opcode, id , state);
-      if (Diag::LCN) DIAG(F("LCN OUT %c/%d/%d"), opcode, id , state);
-   }
+  if (!stream) return;
+  for (byte i=0; i<pendingCount; i++) {
+    if (pending[i].opcode == opcode && pending[i].id == id) {
+      pending[i].state = state;
+      return;
+    }
+  }
+  if (pendingCount >= MAX_PENDING) flush();
+  if (pendingCount == 0) pendingSince = millis();
+  pending[pendingCount++] = {opcode, state, id};
+}
+
+// Send the pending changes.  Peers of version 2 or later get them in a
+// single frame  B/n/c/id/s/c/id/s...  where n is the number of items.
+// Older peers get each change as  c/id/s  as before.
+void LCN::flush() {
+  if (peerVersion >= 2 && pendingCount > 1) {
+    StringFormatter::send(stream, F("B/%d"), pendingCount);
+    for (byte i=0; i<pendingCount; i++) 
+      StringFormatter::send(stream, F("/%c/%d/%d"), pending[i].opcode, pending[i].id, pending[i].state);
+    if (Diag::LCN) DIAG(F("LCN OUT B/%d"), pendingCount);
+  } else {
+    for (byte i=0; i<pendingCount; i++) {
+      StringFormatter::send(stream, F("%c/%d/%d"), pending[i].opcode, pending[i].id, pending[i].state);
+      if (Diag::LCN) DIAG(F("LCN OUT %c/%d/%d"), pending[i].opcode, pending[i].id, pending[i].state);
+    }
+  }
+  pendingCount = 0;
 }
@@ -22,15 +22,35 @@
 #define LCN_h
 #include <Arduino.h>
 
+// Outbound changes are held for up to LCN_BATCH_MS so that, for example,
+// a route throwing many turnouts goes out as one frame.
+#ifndef LCN_BATCH_MS
+#define LCN_BATCH_MS 20
+#endif
+
 class LCN {
   public: 
     static void init(Stream & lcnstream);
     static void loop();
     static void send(char opcode, int id, bool state);
   private :
+    static void flush();
     static bool firstLoop; 
     static Stream * stream; 
-    static int id;
+    static uint32_t id;
+    // Protocol version announced by the LCN peer (nnnV), 0 if none.
+    static byte peerVersion;
+    // First sensor id for the next bulk sensor frame (nnnB).
+    static int bulkSensorId;
+    struct PendingItem {
+      char opcode;
+      bool state;
+      int id;
+    };
+    static const byte MAX_PENDING = 16;
+    static PendingItem pending[MAX_PENDING];
+    static byte pendingCount;
+    static unsigned long pendingSince;
 };
 
 #endif
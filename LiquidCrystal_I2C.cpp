@@ -52,7 +52,7 @@ LiquidCrystal_I2C::LiquidCrystal_I2C(I2CAddress lcd_Addr, uint8_t lcd_cols,
 bool LiquidCrystal_I2C::begin() {
 
   I2CManager.begin();
-  I2CManager.setClock(100000L);    // PCF8574 is spec'd to 100kHz.
+  I2CManager.setClock(_Addr, 100000L);    // PCF8574 is spec'd to 100kHz.
 
   if (I2CManager.exists(_Addr)) {
     DIAG(F("%dx%d LCD configured on I2C:%s"), (int)lcdCols, (int)lcdRows, _Addr.toString());
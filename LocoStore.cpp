@@ -0,0 +1,176 @@
+/*
+ *  © 2024, DCC-EX contributors. All rights reserved.
+ *
+ *  This file is part of CommandStation-EX
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CommandStation.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "LocoStore.h"
+#ifdef LOCO_STORE_ACTIVE
+#include <stddef.h>
+#include "EEStore.h"
+#include "DCC.h"
+#include "DIAG.h"
+
+uint16_t LocoStore::savedChecksum = 0;
+unsigned long LocoStore::lastCheck = 0;
+unsigned long LocoStore::lastWrite = 0;
+
+// groupFlags bits which are stored.  The top bit (consist member) is not,
+// as it is set from the consist table when the loco's slot is created.
+const byte STORED_FLAGS = 0x7f;
+
+int LocoStore::base() {
+  return EEPROM.length() - sizeof(StoreData);
+}
+
+// Called from DCC::begin() after the EEStore has been loaded.
+void LocoStore::init() {
+  char id[sizeof(LOCO_STORE_ID)];
+  EEPROM.get(base(), id);
+  if (strncmp(id, LOCO_STORE_ID, sizeof(LOCO_STORE_ID)) != 0) {
+    clear();
+    DIAG(F("LocoStore initialised, %d bytes at %d"), (int)sizeof(StoreData), base());
+  } else
+    restore();
+  savedChecksum = checksum();
+}
+
+void LocoStore::clear() {
+  StoredLoco loco = {0, 0, 0, 0};
+  for (byte i=0; i<LOCO_STORE_LOCOS; i++)
+    EEPROM.put(base() + offsetof(StoreData, locos) + i*sizeof(StoredLoco), loco);
+  int16_t unused = 0;
+  for (byte i=0; i<LOCO_STORE_ROSTER; i++)
+    EEPROM.put(base() + offsetof(StoreData, roster) + i*sizeof(StoredRoster), unused);
+  EEPROM.put(base(), LOCO_STORE_ID);
+}
+
+// Reinstate the stored locos in the reminder table.  They are restored
+// stopped, with their previous direction, speed steps and functions.
+void LocoStore::restore() {
+  byte count = 0;
+  for (byte i=0; i<LOCO_STORE_LOCOS; i++) {
+    StoredLoco stored;
+    EEPROM.get(base() + offsetof(StoreData, locos) + i*sizeof(StoredLoco), stored);
+    if (stored.loco <= 0) continue;
+    int reg = DCC::lookupSpeedTable(stored.loco);
+    if (reg < 0) break;
+    DCC::speedTable[reg].speedCode = stored.speedCode & 0x80;
+    DCC::speedTable[reg].groupFlags = (DCC::speedTable[reg].groupFlags & ~STORED_FLAGS)
+                                      | (stored.groupFlags & STORED_FLAGS);
+    DCC::speedTable[reg].functions = stored.functions;
+    count++;
+  }
+  if (count) DIAG(F("LocoStore restored %d locos"), count);
+}
+
+// Checksum over the parts of the reminder table that are stored, so that
+// loop() can tell cheaply whether anything needs writing.
+uint16_t LocoStore::checksum() {
+  uint16_t sum = 0;
+  byte count = 0;
+  for (int reg=0; reg<MAX_LOCOS && count<LOCO_STORE_LOCOS; reg++) {
+    DCC::LOCO * slot = &DCC::speedTable[reg];
+    if (slot->loco <= 0) continue;
+    sum = sum*31 + slot->loco;
+    sum = sum*31 + ((slot->speedCode & 0x80) | (slot->groupFlags & STORED_FLAGS));
+    sum = sum*31 + (uint16_t)slot->functions;
+    sum = sum*31 + (uint16_t)(slot->functions >> 16);
+    count++;
+  }
+  return sum;
+}
+
+void LocoStore::save() {
+  byte i = 0;
+  for (int reg=0; reg<MAX_LOCOS && i<LOCO_STORE_LOCOS; reg++) {
+    DCC::LOCO * slot = &DCC::speedTable[reg];
+    if (slot->loco <= 0) continue;
+    StoredLoco stored = {(int16_t)slot->loco, (byte)(slot->speedCode & 0x80),
+                          (byte)(slot->groupFlags & STORED_FLAGS), (uint32_t)slot->functions};
+    // put() only rewrites bytes that have changed
+    EEPROM.put(base() + offsetof(StoreData, locos) + i*sizeof(StoredLoco), stored);
+    i++;
+  }
+  StoredLoco unused = {0, 0, 0, 0};
+  for (; i<LOCO_STORE_LOCOS; i++)
+    EEPROM.put(base() + offsetof(StoreData, locos) + i*sizeof(StoredLoco), unused);
+}
+
+void LocoStore::loop() {
+  unsigned long now = millis();
+  if (now - lastCheck < 1000) return;
+  lastCheck = now;
+  if (now - lastWrite < LOCO_STORE_WRITE_MS) return;
+  uint16_t sum = checksum();
+  if (sum == savedChecksum) return;
+  save();
+  savedChecksum = sum;
+  lastWrite = now;
+}
+
+// Add, replace or (with an empty name) remove a roster entry.
+bool LocoStore::setRoster(int16_t loco, const char * name, const char * functions) {
+  if (loco <= 0) return false;
+  int freeEntry = -1;
+  byte i;
+  for (i=0; i<LOCO_STORE_ROSTER; i++) {
+    int16_t id = getRosterId(i);
+    if (id == loco) break;
+    if (id == 0 && freeEntry < 0) freeEntry = i;
+  }
+  if (i == LOCO_STORE_ROSTER) {
+    if (name[0] == '\0') return true;  // nothing to remove
+    if (freeEntry < 0) {
+      DIAG(F("LocoStore roster full"));
+      return false;
+    }
+    i = freeEntry;
+  }
+  int address = base() + offsetof(StoreData, roster) + i*sizeof(StoredRoster);
+  if (name[0] == '\0') {
+    EEPROM.put(address, (int16_t)0);
+    return true;
+  }
+  StoredRoster entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.loco = loco;
+  strncpy(entry.name, name, LOCO_STORE_NAME_SIZE-1);
+  strncpy(entry.functions, functions, LOCO_STORE_FUNCTIONS_SIZE-1);
+  EEPROM.put(address, entry);
+  return true;
+}
+
+bool LocoStore::getRoster(int16_t loco, char * name, char * functions) {
+  if (loco <= 0) return false;
+  for (byte i=0; i<LOCO_STORE_ROSTER; i++) {
+    if (getRosterId(i) != loco) continue;
+    int address = base() + offsetof(StoreData, roster) + i*sizeof(StoredRoster);
+    EEPROM.get(address + offsetof(StoredRoster, name), *(char (*)[LOCO_STORE_NAME_SIZE])name);
+    EEPROM.get(address + offsetof(StoredRoster, functions), *(char (*)[LOCO_STORE_FUNCTIONS_SIZE])functions);
+    return true;
+  }
+  return false;
+}
+
+int16_t LocoStore::getRosterId(byte index) {
+  if (index >= LOCO_STORE_ROSTER) return 0;
+  int16_t id;
+  EEPROM.get(base() + offsetof(StoreData, roster) + index*sizeof(StoredRoster), id);
+  return id;
+}
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ *  © 2024, DCC-EX contributors. All rights reserved.
+ *
+ *  This file is part of CommandStation-EX
+ *
+ *  This is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  It is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with CommandStation.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef LocoStore_h
+#define LocoStore_h
+
+#include "defines.h"
+
+/*
+ * LocoStore keeps a copy of the loco reminder table (address, direction,
+ * speed step mode and function states) and any roster entries added by
+ * command in an area at the top of the EEPROM, so that after a reset or
+ * brown-out the locos are reinstated with their functions as they were.
+ * Locos are always restored stopped, so that nothing moves until a
+ * throttle asks it to.
+ *
+ * The EEPROM is only written when the table has changed, and no more
+ * often than once every LOCO_STORE_WRITE_MS.  Only bytes which differ are
+ * rewritten.  Speed changes alone don't cause a write.
+ *
+ * The store is enabled by defining LOCO_STORE in config.h.  It sits below
+ * the end of the EEPROM, so the space available for turnouts, sensors and
+ * outputs saved with <E> is reduced accordingly.
+ */
+#if defined(LOCO_STORE) && !defined(DISABLE_EEPROM)
+#define LOCO_STORE_ACTIVE
+
+#include <Arduino.h>
+
+#ifndef LOCO_STORE_LOCOS
+  #define LOCO_STORE_LOCOS 8
+#endif
+#ifndef LOCO_STORE_ROSTER
+  #define LOCO_STORE_ROSTER 4
+#endif
+#ifndef LOCO_STORE_NAME_SIZE
+  #define LOCO_STORE_NAME_SIZE 16
+#endif
+#ifndef LOCO_STORE_FUNCTIONS_SIZE
+  #define LOCO_STORE_FUNCTIONS_SIZE 64
+#endif
+#ifndef LOCO_STORE_WRITE_MS
+  #define LOCO_STORE_WRITE_MS 10000
+#endif
+
+#define LOCO_STORE_ID "LOCO1"
+
+class LocoStore {
+public:
+  static void init();
+  static void loop();
+  static void clear();
+  static int base();  // EEPROM address of start of store
+
+  // Runtime roster.  Name and function labels are copied into the
+  // caller's buffers, which must be LOCO_STORE_NAME_SIZE and
+  // LOCO_STORE_FUNCTIONS_SIZE bytes.  Returns false if no entry.
+  static bool setRoster(int16_t loco, const char * name, const char * functions);
+  static bool getRoster(int16_t loco, char * name, char * functions);
+  static int16_t getRosterId(byte index);  // 0 if entry unused
+
+private:
+  struct StoredLoco {
+    int16_t loco;
+    byte speedCode;   // only the direction bit is kept
+    byte groupFlags;
+    uint32_t functions;
+  };
+  struct StoredRoster {
+    int16_t loco;
+    char name[LOCO_STORE_NAME_SIZE];
+    char functions[LOCO_STORE_FUNCTIONS_SIZE];
+  };
+  struct StoreData {
+    char id[sizeof(LOCO_STORE_ID)];
+    StoredLoco locos[LOCO_STORE_LOCOS];
+    StoredRoster roster[LOCO_STORE_ROSTER];
+  };
+  static void restore();
+  static void save();
+  static uint16_t checksum();
+  static uint16_t savedChecksum;
+  static unsigned long lastCheck;
+  static unsigned long lastWrite;
+};
+
+#endif
+#endif
@@ -141,6 +141,20 @@ class MotorDriver {
 	}
       }
     };
+    // RailCom cutout, called from interrupt context.  The track outputs are
+    // shorted together so that decoders can send RailCom data: both outputs 
+    // low on dual signal drivers, otherwise through the brake.  
+    // setCutoutSignal() is called with the signal ports shadowed, and 
+    // setCutoutBrake() after they are written back.
+    inline void setCutoutSignal(bool on) {
+      if (on && dualSignal && !trackPWM) {
+        setLOW(fastSignalPin);
+        setLOW(fastSignalPin2);
+      }
+    };
+    inline void setCutoutBrake(bool on) {
+      if (!dualSignal && !trackPWM) setBrake(on, true);
+    };
     inline void enableSignal(bool on) {
       if (on)
 	pinMode(signalPin, OUTPUT);
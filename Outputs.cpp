@@ -120,6 +120,7 @@ void  Output::activate(uint16_t s){
 //   Return NULL if not found.
 
 Output* Output::get(uint16_t n){
+  if (outputIndex.isValid()) return (Output *)outputIndex.find(n);
   Output *tt;
   for(tt=firstOutput;tt!=NULL && tt->data.id!=n;tt=tt->nextOutput);
   return(tt);
@@ -140,6 +141,9 @@ bool Output::remove(uint16_t n){
     firstOutput=tt->nextOutput;
   else
     pp->nextOutput=tt->nextOutput;
+  if(tt==lastOutput)
+    lastOutput=pp;
+  outputIndex.remove(n);
 
   free(tt);
 
@@ -195,18 +199,19 @@ Output *Output::create(uint16_t id, VPIN pin, int iFlag, int v){
 
   if (pin > VPIN_MAX) return NULL;
   
-  if(firstOutput==NULL){
-    firstOutput=(Output *)calloc(1,sizeof(Output));
-    tt=firstOutput;
-  } else if((tt=get(id))==NULL){
-    tt=firstOutput;
-    while(tt->nextOutput!=NULL)
-      tt=tt->nextOutput;
-    tt->nextOutput=(Output *)calloc(1,sizeof(Output));
-    tt=tt->nextOutput;
+  if((tt=get(id))==NULL){
+    // Not found, so create new object on end of list
+    tt=(Output *)calloc(1,sizeof(Output));
+    if(tt==NULL) return tt;
+    if(firstOutput==NULL)
+      firstOutput=tt;
+    else
+      lastOutput->nextOutput=tt;
+    lastOutput=tt;
+    tt->data.id=id;
+    outputIndex.insert(tt);
   }
 
-  if(tt==NULL) return tt;
   tt->num = 0; // make sure new object doesn't get written to EEPROM until store() command
   tt->data.id=id;
   tt->data.pin=pin;
@@ -227,3 +232,5 @@ Output *Output::create(uint16_t id, VPIN pin, int iFlag, int v){
 ///////////////////////////////////////////////////////////////////////////////
 
 Output *Output::firstOutput=NULL;
+Output *Output::lastOutput=NULL;
+IdIndex Output::outputIndex(Output::getIdOf);
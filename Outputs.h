@@ -24,6 +24,7 @@
 
 #include <Arduino.h>
 #include "IODevice.h"
+#include "IdIndex.h"
 
 struct OutputData {
   union {
@@ -62,6 +63,10 @@ public:
   static void printAll(Print *);
 private:
   uint16_t num;  // EEPROM address of oStatus in OutputData struct, or zero if not stored.
+  static Output *lastOutput;
+  // Index for get(id), see IdIndex.h
+  static IdIndex outputIndex;
+  static uint16_t getIdOf(void *tt) { return ((Output *)tt)->data.id; }
   
 }; // Output
   
@@ -159,7 +159,6 @@ SSD1306AsciiWire::SSD1306AsciiWire(I2CAddress address, int width, int height) {
 
 bool SSD1306AsciiWire::begin() {
   I2CManager.begin();
-  I2CManager.setClock(400000L);  // Set max supported I2C speede
 
   if (m_i2cAddr == 0) {
     // Probe for I2C device on 0x3c and 0x3d.
@@ -172,6 +171,8 @@ bool SSD1306AsciiWire::begin() {
     if (m_i2cAddr == 0)
       DIAG(F("OLED display not found"));
   }
+  // Set max supported I2C speed, on the bus the display is on
+  I2CManager.setClock(m_i2cAddr, 400000L);
 
   m_col = 0;
   m_row = 0;
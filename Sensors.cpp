@@ -93,13 +93,6 @@ decide to ignore the <q ID> return and only react to <Q ID> triggers.
 void Sensor::checkAll(){
   uint16_t sensorCount = 0;
 
-#ifdef USE_NOTIFY
-  // Register the event handler ONCE!
-  if (!inputChangeCallbackRegistered)
-    IONotifyCallback::add(inputChangeCallback);
-  inputChangeCallbackRegistered = true;
-#endif
-
   if (firstSensor == NULL) return;  // No sensors to be scanned
   if (readingSensor == NULL) { 
     // Not currently scanning sensor list
@@ -138,6 +131,7 @@ void Sensor::checkAll(){
       readingSensor->active = readingSensor->inputState;
       readingSensor->latchDelay = minReadCount;  // Reset counter
       
+      if (Diag::RECORD) DIAG(F("REC %l S %d %d"), millis(), readingSensor->data.snum, readingSensor->active);
       CommandDistributor::broadcastSensor(readingSensor->data.snum,readingSensor->active);
       pause = true;  // Don't check any more sensors on this entry
     }
@@ -166,7 +160,7 @@ void Sensor::inputChangeCallback(VPIN vpin, int state) {
   // This bit is not ideal since it has, potentially, to look through the entire list of
   // sensors to find the one that has changed.  Ideally this should be improved somehow.
   for (tt=firstSensor; tt!=NULL ; tt=tt->nextSensor) {
-    if (tt->data.pin == vpin) break;
+    if (tt->data.pin == vpin && !tt->pollingRequired) break;
   }
   if (tt != NULL) { // Sensor found
     tt->inputState = (state != 0); 
@@ -205,8 +199,15 @@ Sensor *Sensor::create(int snum, VPIN pin, int pullUp){
   if (pin == VPIN_NONE) 
     tt->pollingRequired = false;
   #ifdef USE_NOTIFY
-  else if (IODevice::hasCallback(pin)) 
+  else if (IODevice::hasCallback(pin)) {
     tt->pollingRequired = false;
+    // Register the event handler ONCE, and only for the range of VPINs
+    // that have notifying sensors on them.
+    if (!inputChangeCallbackBlock)
+      inputChangeCallbackBlock = IONotifyCallback::add(inputChangeCallback, pin, pin);
+    else
+      inputChangeCallbackBlock->extend(pin);
+  }
   #endif
   else 
     tt->pollingRequired = true;
@@ -316,5 +317,5 @@ unsigned long Sensor::lastReadCycle=0;
 #ifdef USE_NOTIFY
 Sensor *Sensor::firstPollSensor = NULL;
 Sensor *Sensor::lastSensor = NULL;
-bool Sensor::inputChangeCallbackRegistered = false;
+IONotifyCallback *Sensor::inputChangeCallbackBlock = NULL;
 #endif
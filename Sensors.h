@@ -90,7 +90,7 @@ public:
 
 #ifdef USE_NOTIFY
   static void inputChangeCallback(VPIN vpin, int state);
-  static bool inputChangeCallbackRegistered;
+  static IONotifyCallback *inputChangeCallbackBlock;
 #endif
   
 }; // Sensor
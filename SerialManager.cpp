@@ -36,20 +36,34 @@ BluetoothSerial SerialBT;
 #endif //COMMANDS
 #endif //ESP32
 
+// With the wifi task on core 0, its output to the USB port can arrive
+// while loop() on core 1 is emptying the same buffer.
+#if defined(ARDUINO_ARCH_ESP32) && defined(WIFI_TASK_ON_CORE0)
+static portMUX_TYPE txMux = portMUX_INITIALIZER_UNLOCKED;
+#define TX_LOCK() portENTER_CRITICAL(&txMux)
+#define TX_UNLOCK() portEXIT_CRITICAL(&txMux)
+#else
+#define TX_LOCK()
+#define TX_UNLOCK()
+#endif
+
 SerialManager * SerialManager::first=NULL;
+bool SerialManager::loopStarted=false;
 
-SerialManager::SerialManager(Stream * myserial) {
+SerialManager::SerialManager(Stream * myserial, bool isBuffered) {
   serial=myserial;
   next=first;
   first=this;
   bufferLength=0;
   inCommandPayload=false; 
+  buffered=isBuffered;
 } 
 
 void SerialManager::init() {
   USB_SERIAL.begin(115200);
   while (!USB_SERIAL && millis() < 5000); // wait max 5s for Serial to start
-  new SerialManager(&USB_SERIAL);
+  // DIAG output goes through the USB port's buffer too
+  StringFormatter::setDiagSerial(new SerialManager(&USB_SERIAL));
   
 #ifdef SERIAL6_COMMANDS
   Serial6.begin(115200);
@@ -83,7 +97,7 @@ void SerialManager::init() {
     snprintf(idstr, 15, "DCCEX-%08X",
 	     __builtin_bswap32((uint32_t)(chipid>>16)));
     SerialBT.begin(idstr);
-    new SerialManager(&SerialBT);
+    new SerialManager(&SerialBT, false); // no availableForWrite() on BT
     delay(1000);
   }
 #endif
@@ -96,14 +110,112 @@ void SerialManager::broadcast(char * stringBuffer) {
     for (SerialManager * s=first;s;s=s->next) s->broadcast2(stringBuffer);
 }
 void SerialManager::broadcast2(char * stringBuffer) {
-    serial->print(stringBuffer);
+    print(stringBuffer);
+}
+
+void SerialManager::showStatus(Print * stream) {
+    for (SerialManager * s=first;s;s=s->next) 
+      StringFormatter::send(stream, F("<* Serial TX buffered:%d dropped lines:%d bytes:%l *>\n"), 
+        s->txCount, s->droppedLines, s->droppedBytes);
+}
+
+Print * SerialManager::output(Stream * port) {
+    for (SerialManager * s=first;s;s=s->next) 
+      if (s->serial==port) return s;
+    return port;
 }
 
 void SerialManager::loop() {
+    loopStarted=true;
     for (SerialManager * s=first;s;s=s->next) s->loop2();
 }
 
+// Output is written straight to the port when nothing is buffered and the 
+// port has room.  Until loop() is running (i.e. during setup) output is 
+// always written straight to the port, so none is lost at startup.
+size_t SerialManager::write(uint8_t c) {
+    if (!buffered || !loopStarted) return serial->write(c);
+    TX_LOCK();
+    bool empty = (txCount==0 && !droppingLine);
+    TX_UNLOCK();
+    // (the port is not called with the lock held)
+    if (empty && serial->availableForWrite() > 0) return serial->write(c);
+    TX_LOCK();
+    if (droppingLine) {
+      // Discard the rest of a line that didn't fit
+      droppedBytes++;
+      if (c=='\n') droppingLine=false;
+      TX_UNLOCK();
+      return 1;
+    }
+    if (txCount >= SERIAL_TX_BUFFER) {
+#if defined(SERIAL_TX_DROP_OLDEST)
+      if (txSending==0) discardOldestLine();
+#endif
+      if (txCount >= SERIAL_TX_BUFFER) {
+        // No room, so drop this line including the part already buffered,
+        // apart from anything already on its way to the port.
+        uint16_t unsent = txCount - txSending;
+        uint16_t retract = (lineLength < unsent) ? lineLength : unsent;
+        txCount -= retract;
+        droppedBytes += retract + 1;
+        droppedLines++;
+        lineLength = 0;
+        droppingLine = (c!='\n');
+        TX_UNLOCK();
+        return 1;
+      }
+    }
+    txBuffer[(txTail + txCount++) % SERIAL_TX_BUFFER] = c;
+    lineLength = (c=='\n') ? 0 : lineLength+1;
+    TX_UNLOCK();
+    return 1;
+}
+
+// Discard buffered output up to and including the oldest newline.  The 
+// line being written is never discarded here.
+void SerialManager::discardOldestLine() {
+    uint16_t n;
+    for (n=0; n < txCount-lineLength; n++) {
+      if (txBuffer[(txTail + n) % SERIAL_TX_BUFFER] == '\n') {
+        n++;
+        txTail = (txTail + n) % SERIAL_TX_BUFFER;
+        txCount -= n;
+        droppedBytes += n;
+        droppedLines++;
+        return;
+      }
+    }
+}
+
+// Send as much of the buffered output as the port will take without blocking.
+// The bytes being sent are marked with txSending, so that a writer on the
+// other core (WIFI_TASK_ON_CORE0) leaves them alone while the port's
+// write() runs outside the lock.
+void SerialManager::sendBuffered() {
+    for (;;) {
+      int room = serial->availableForWrite();
+      if (room <= 0) return;
+      TX_LOCK();
+      uint16_t len = SERIAL_TX_BUFFER - txTail;  // contiguous bytes to end of buffer
+      if (len > txCount) len = txCount;
+      if (len > (uint16_t)room) len = room;
+      txSending = len;
+      uint16_t tail = txTail;
+      TX_UNLOCK();
+      if (len == 0) return;
+      serial->write(txBuffer + tail, len);
+      TX_LOCK();
+      txTail = (txTail + len) % SERIAL_TX_BUFFER;
+      txCount -= len;
+      txSending = 0;
+      if (lineLength > txCount) lineLength = txCount;
+      TX_UNLOCK();
+    }
+}
+
 void SerialManager::loop2() {
+    sendBuffered();
     while (serial->available()) {
         char ch = serial->read();
         if (ch == '<') {
@@ -113,7 +225,7 @@ void SerialManager::loop2() {
         }
         else if (ch == '>') {
             buffer[bufferLength] = '\0';
-            DCCEXParser::parse(serial, buffer, NULL); 
+            DCCEXParser::parse(this, buffer, NULL); 
             inCommandPayload = false;
             break;
         }
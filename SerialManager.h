@@ -29,21 +29,58 @@
  #define COMMAND_BUFFER_SIZE 100
 #endif
 
-class SerialManager {
+// Output to each serial port is held in a software buffer and sent from 
+// loop() as the port has room, so that a slow or disconnected host can't 
+// hold up the loop.  When the buffer is full, the message being written is
+// dropped, or with SERIAL_TX_DROP_OLDEST defined the oldest complete lines
+// are discarded to make room.  Writing never waits for the port.
+// The Mega has a buffer for each of up to four ports in its 8k of RAM, so
+// it gets less than the 32 bit boards.
+#ifndef SERIAL_TX_BUFFER
+ #if defined(HAS_ENOUGH_MEMORY) && !defined(ARDUINO_ARCH_AVR)
+  #define SERIAL_TX_BUFFER 512
+ #elif defined(HAS_ENOUGH_MEMORY)
+  #define SERIAL_TX_BUFFER 128
+ #else
+  #define SERIAL_TX_BUFFER 64
+ #endif
+#endif
+
+class SerialManager : public Print {
 public:
   static void init();
   static void loop();
   static void broadcast(char * stringBuffer);
+  static void showStatus(Print * stream);
+  // Where to send output for a port: its SerialManager if it has one,
+  // otherwise the port itself.  Anything written to a managed port must 
+  // go this way, or it may overtake output still in the buffer.
+  static Print * output(Stream * port);
+  // Print interface, output is buffered
+  size_t write(uint8_t c) override;
   
 private:  
   static SerialManager * first;
-  SerialManager(Stream * myserial);
+  static bool loopStarted;
+  SerialManager(Stream * myserial, bool buffered=true);
   void loop2();
   void broadcast2(char * stringBuffer);
+  void sendBuffered();
+  void discardOldestLine();
   Stream * serial;
   SerialManager * next;
   byte bufferLength;
   byte buffer[COMMAND_BUFFER_SIZE]; 
   bool inCommandPayload;
+  // Transmit ring buffer
+  bool buffered;
+  bool droppingLine = false;   // discarding the rest of an overflowed line
+  uint16_t txTail = 0;         // index of oldest byte
+  uint16_t txCount = 0;        // bytes in buffer
+  uint16_t txSending = 0;      // bytes from txTail being written to the port
+  uint16_t lineLength = 0;     // bytes in buffer of the line being written
+  uint16_t droppedLines = 0;
+  uint32_t droppedBytes = 0;
+  byte txBuffer[SERIAL_TX_BUFFER];
 };
 #endif
@@ -26,24 +26,26 @@ bool Diag::WIFI=false;
 bool Diag::WITHROTTLE=false;
 bool Diag::ETHERNET=false;
 bool Diag::LCN=false;
+bool Diag::RECORD=false;
 
+Print * StringFormatter::diagSerial=&USB_SERIAL;
  
 void StringFormatter::diag( const FSH* input...) {
- USB_SERIAL.print(F("<* "));   
+  diagSerial->print(F("<* "));   
   va_list args;
   va_start(args, input);
-  send2(&USB_SERIAL,input,args);
-  USB_SERIAL.print(F(" *>\n"));
+  send2(diagSerial,input,args);
+  diagSerial->print(F(" *>\n"));
 }
 
 void StringFormatter::lcd(byte row, const FSH* input...) {
   va_list args;
 
   // Issue the LCD as a diag first
-  send(&USB_SERIAL,F("<* LCD%d:"),row);
+  send(diagSerial,F("<* LCD%d:"),row);
   va_start(args, input);
-  send2(&USB_SERIAL,input,args);
-  send(&USB_SERIAL,F(" *>\n"));
+  send2(diagSerial,input,args);
+  send(diagSerial,F(" *>\n"));
   
   DisplayInterface::setRow(row);    
   va_start(args, input);
@@ -181,7 +183,7 @@ void StringFormatter::printEscapes(Print * stream, const FSH * input) {
 }
 
 void StringFormatter::printEscape( char c) {
-  printEscape(&USB_SERIAL,c);
+  printEscape(diagSerial,c);
 }
 
 void StringFormatter::printEscape(Print * stream, char c) {
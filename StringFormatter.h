@@ -30,6 +30,7 @@ class Diag {
   static bool WITHROTTLE;
   static bool ETHERNET;
   static bool LCN;
+  static bool RECORD;
   
 };
 
@@ -49,8 +50,11 @@ class StringFormatter
     static void lcd2(uint8_t display, byte row, const FSH* input...);
     static void printEscapes(char * input);
     static void printEscape( char c);
+    // Output for DIAG and LCD messages, normally the USB serial port.
+    static inline void setDiagSerial(Print * serial) { diagSerial = serial; }
 
     private: 
+    static Print * diagSerial;
     static void send2(Print * serial, const FSH* input,va_list args);
     static void printPadded(Print* stream, long value, byte width, bool formatLeft);
 
@@ -159,10 +159,24 @@ void TrackManager::setDCCSignal( bool on) {
   HAVE_PORTC(PORTC=shadowPORTC);
 }
 
+// setCutout(), called from interrupt context for the RailCom cutout.
+// A prog track joined to main gets the cutout too.  Whether it is joined is
+// taken at the start of the cutout, so a join part way through can't leave
+// the prog track braked.
+static bool cutoutProg=false;
 void TrackManager::setCutout( bool on) {
-    (void) on;
-    // TODO Cutout needs fake ports as well
-    // TODO      APPLY_BY_MODE(TRACK_MODE_MAIN,setCutout(on));
+  if (on) cutoutProg=progTrackSyncMain;
+  HAVE_PORTA(shadowPORTA=PORTA);
+  HAVE_PORTB(shadowPORTB=PORTB);
+  HAVE_PORTC(shadowPORTC=PORTC);
+  APPLY_BY_MODE(TRACK_MODE_MAIN,setCutoutSignal(on));
+  if (cutoutProg) APPLY_BY_MODE(TRACK_MODE_PROG,setCutoutSignal(on));
+  HAVE_PORTA(PORTA=shadowPORTA);
+  HAVE_PORTB(PORTB=shadowPORTB);
+  HAVE_PORTC(PORTC=shadowPORTC);
+  // Brake pins aren't shadowed so are set after the ports are written back
+  APPLY_BY_MODE(TRACK_MODE_MAIN,setCutoutBrake(on));
+  if (cutoutProg) APPLY_BY_MODE(TRACK_MODE_PROG,setCutoutBrake(on));
 }
 
 // setPROGSignal(), called from interrupt context
@@ -34,6 +34,7 @@
 #include "Turnouts.h"
 #include "DCC.h"
 #include "LCN.h"
+#include "SerialManager.h"
 #ifdef EESTOREDEBUG
 #include "DIAG.h"
 #endif
@@ -43,6 +44,8 @@
    */ 
 
   /* static */ Turnout *Turnout::_firstTurnout = 0;
+  /* static */ Turnout *Turnout::_lastTurnout = 0;
+  /* static */ IdIndex Turnout::_index(Turnout::getIdOf);
 
   /* 
    * Public static data
@@ -54,7 +57,9 @@
    */
 
   /* static */ Turnout *Turnout::get(uint16_t id) {
-    // Find turnout object from list.
+    // Find turnout object from index, or from list if the index 
+    // couldn't be allocated.
+    if (_index.isValid()) return (Turnout *)_index.find(id);
     for (Turnout *tt = _firstTurnout; tt != NULL; tt = tt->_nextTurnout)
       if (tt->_turnoutData.id == id) return tt;
     return NULL;
@@ -64,13 +69,10 @@
   /* static */ void Turnout::add(Turnout *tt) {
     if (!_firstTurnout) 
       _firstTurnout = tt;
-    else {
-      // Find last object on chain
-      Turnout *ptr = _firstTurnout;
-      for ( ; ptr->_nextTurnout!=0; ptr=ptr->_nextTurnout) {}
-      // Line new object to last object.
-      ptr->_nextTurnout = tt;
-    }
+    else
+      _lastTurnout->_nextTurnout = tt;
+    _lastTurnout = tt;
+    _index.insert(tt);
     turnoutlistHash++;
   }
   
@@ -87,6 +89,9 @@
       _firstTurnout = tt->_nextTurnout;
     else
       pp->_nextTurnout = tt->_nextTurnout;
+    if (tt == _lastTurnout)
+      _lastTurnout = pp;
+    _index.remove(id);
 
     delete (ServoTurnout *)tt;
 
@@ -198,7 +203,7 @@
     }
 
 #ifdef EESTOREDEBUG
-    printAll(&USB_SERIAL);
+    printAll(SerialManager::output(&USB_SERIAL));
 #endif
     return tt;
   }
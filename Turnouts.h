@@ -30,6 +30,7 @@
 #include "Arduino.h"
 #include "IODevice.h"
 #include "StringFormatter.h"
+#include "IdIndex.h"
 
 // Turnout type definitions
 enum {
@@ -95,7 +96,11 @@ protected:
    */ 
 
   static Turnout *_firstTurnout;
+  static Turnout *_lastTurnout;
   static int _turnoutlistHash;
+  // Index for get(id), see IdIndex.h
+  static IdIndex _index;
+  static uint16_t getIdOf(void *tt) { return ((Turnout *)tt)->_turnoutData.id; }
 
   /* 
    * Virtual functions
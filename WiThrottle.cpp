@@ -122,6 +122,7 @@ void WiThrottle::parse(RingStream * stream, byte * cmdx) {
   
   heartBeat=millis();
   if (Diag::WITHROTTLE) DIAG(F("%l WiThrottle(%d)<-[%e]"),millis(),clientid,cmd);
+  if (Diag::RECORD) DIAG(F("REC %l W %d %e"),millis(),clientid,cmd);
   
   // On first few commands, send turnout, roster and routes 
   if (introSent) {  
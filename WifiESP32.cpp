@@ -30,6 +30,7 @@
 #include "RingStream.h"
 #include "CommandDistributor.h"
 #include "WiThrottle.h"
+#include "SerialManager.h"
 /*
 #include "soc/rtc_wdt.h"
 #include "esp_task_wdt.h"
@@ -361,7 +362,7 @@ void WifiESP::loop() {
       esp_wifi_connect();
       uint8_t tries=40;
       while (WiFi.status() != WL_CONNECTED && tries) {
-	Serial.print('.');
+	SerialManager::output(&Serial)->print('.');
 	tries--;
 	delay(500);
       }
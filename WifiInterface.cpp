@@ -26,6 +26,7 @@
 //#include <avr/pgmspace.h>
 #include "DIAG.h"
 #include "StringFormatter.h"
+#include "SerialManager.h"
 
 #include "WifiInboundHandler.h"
 
@@ -434,7 +435,7 @@ bool WifiInterface::checkForOK( const unsigned int timeout, const FSH * waitfor,
       char ch = (char)nextchar;
       if (echo) {
         if (escapeEcho) StringFormatter::printEscape( ch); /// THIS IS A DIAG IN DISGUISE
-        else USB_SERIAL.print(ch);
+        else SerialManager::output(&USB_SERIAL)->print(ch);
       }
       if (ch != GETFLASH(locator)) locator = (char *)waitfor;
       if (ch == GETFLASH(locator)) {
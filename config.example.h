@@ -180,6 +180,17 @@ The configuration file for DCC-EX Command Station
 //
 // #define DISABLE_EEPROM
 
+/////////////////////////////////////////////////////////////////////////////////////
+// LOCO STORE
+//
+// Keep the locos in use (direction, speed steps and functions) and roster
+// entries added with <JR id "name" "functions"> in the EEPROM, so that
+// after a reset they are restored, stopped, with their lights etc as they
+// were.  The store takes about 400 bytes at the top of the EEPROM. 
+// LOCO_STORE_LOCOS and LOCO_STORE_ROSTER set the number of entries.
+//
+// #define LOCO_STORE
+
 /////////////////////////////////////////////////////////////////////////////////////
 // DISABLE PROG
 //
@@ -231,6 +242,12 @@ The configuration file for DCC-EX Command Station
 // (throw turnout).
 //#define DCC_ACCESSORY_RCN_213
 //
+// By default the "off" packet for an accessory is sent straight after the
+// "on" packet.  Set a pulse time (ms) here to have the "off" packet follow
+// after that time instead.  Individual accessories can be given their own 
+// pulse time with <D ACCPULSE linearaddress ms>.
+//#define ACCESSORY_PULSE_MS 100
+//
 // HANDLING MULTIPLE SERIAL THROTTLES
 // The command station always operates with the default Serial port.
 // Diagnostics are only emitted on the default serial port and not broadcast.
@@ -266,6 +283,17 @@ The configuration file for DCC-EX Command Station
 //
 //#define SERIAL_BT_COMMANDS
 
+// SERIAL OUTPUT BUFFERING
+//
+// Output to the serial ports is buffered and sent as the port has room,
+// so a slow or stalled host doesn't hold up the command station.  The
+// buffer size (per port) can be changed here.  When a buffer is full the
+// newest message is dropped; define SERIAL_TX_DROP_OLDEST to discard the
+// oldest buffered messages instead.  <D SERIAL> shows the dropped counts.
+//
+//#define SERIAL_TX_BUFFER 512
+//#define SERIAL_TX_DROP_OLDEST
+
 // SABERTOOTH
 //
 // This is a very special option and only useful if you happen to have a
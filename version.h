@@ -3,7 +3,34 @@
 
 #include "StringFormatter.h"
 
-#define VERSION "5.0.9"
+#define VERSION "5.0.34"
+// 5.0.34 - Non-AVR: EXRAIL script image can be loaded into RAM and swapped with </ IMAGE>, </ LOAD>, </ SWAP>
+// 5.0.33 - EXRAIL debugger </ BREAK [pc]>, </ BREAK OP opcode>, </ SUSPEND|RESUME|STEP|DUMP id>
+// 5.0.32 - EXRAIL script checked at startup for undefined targets, duplicates, IF/ENDIF and unfreed blocks, </ VALIDATE> shows sizes
+// 5.0.31 - EXRAIL POST/WAITEVENT/WAITEVENTTIMEOUT, waiting tasks parked off the task ring, </ POST event>
+// 5.0.30 - EXRAIL registers SETREG/ADDREG/SUBREG/INCREG/DECREG, IFREGxx, DELAYREG, SPEEDREG, </ REG id [value]>
+// 5.0.29 - POM writes queued and paced with loco reminders, <w> takes several CV/value pairs
+// 5.0.28 - Optional LocoStore keeps loco state and runtime roster entries in EEPROM
+// 5.0.27 - Buffered non-blocking serial output, <D SERIAL> shows dropped counts
+// 5.0.26 - RailCom cutout on main track <D RAILCOM ON/OFF>
+// 5.0.25 - Per-loco speed steps <D SPEED14|SPEED28|SPEED128 cab>, EXRAIL SPEEDSTEPS, table speed conversion
+// 5.0.24 - Accessory packets queued, timed pulse-off, <A addr aspect> extended accessory, <D ACCPULSE>
+// 5.0.23 - Turnout and Output get(id) via hash index, O(1) add to end of list
+// 5.0.22 - LCN: Turnout changes batched and coalesced, bulk sensor frames
+// 5.0.21 - HAL: Change notifications filtered by VPIN range, GPIO ports notified in one batch
+// 5.0.20 - I2C: Multiple I2C buses (I2CBus_1/2) with own clock speed when using Wire
+// 5.0.19 - ShiftEngine spreads bit-banged transfers over loop entries
+// 5.0.18 - DFPlayer play queue, repeat, folder and equaliser commands
+// 5.0.17 - Non-blocking EX-FastClock read, internal fast clock <JC START/STOP>
+// 5.0.16 - EX-IOExpander combined delta read of inputs when supported by device
+// 5.0.15 - EX-IOExpander output and servo writes queued and sent non-blocking
+// 5.0.14 - HCSR04 measures echo by interrupt where the echo pin allows
+// 5.0.13 - <C> advanced consists using CV19 and one consist speed packet
+// 5.0.12 - DIAG_LOOPTIMES also reports time per loop() responsibility
+// 5.0.11 - <D RECORD ON> logs inbound commands, sensor changes and
+//          clock ticks with timestamps for later replay
+// 5.0.10 - NMRA S-9.1/S-9.2 bit timing and preamble checks at compile time
+//        - DIAG_PACKETS option reports packet mix and rate per loco
 // 5.0.9  - EX-IOExpander bug fix for memory allocation
 //        - EX-IOExpander bug fix to allow for devices with no analogue or no digital pins
 // 5.0.8  - Bugfix: Do not crash on turnouts without description